@@ -50,6 +50,13 @@ bool AABB::collides(const AABB & other) const
 	return (collidesX(other) || collidesY(other));
 }
 
+// Overlap with a positive area, touching edges do not count
+bool AABB::intersects(const AABB & other) const
+{
+	return m_minP.x < other.getMaxP().x && m_maxP.x > other.getMinP().x &&
+		m_minP.y < other.getMaxP().y && m_maxP.y > other.getMinP().y;
+}
+
 void AABB::setMinP(const vec2 & minP)
 {
 	m_minP = minP;
@@ -80,6 +87,14 @@ AABB AABB::operator/(const float f) const
 	return AABB(m_minP / f, m_maxP / f);
 }
 
+AABB AABB::sweep(const vec2 & v) const
+{
+	return AABB(
+		vec2(std::min(m_minP.x, m_minP.x + v.x), std::min(m_minP.y, m_minP.y + v.y)),
+		vec2(std::max(m_maxP.x, m_maxP.x + v.x), std::max(m_maxP.y, m_maxP.y + v.y))
+	);
+}
+
 vec2 AABB::getCenterP() const
 {
 	return 0.5f * (m_minP + m_maxP);
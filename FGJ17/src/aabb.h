@@ -17,12 +17,14 @@ public:
 	bool collidesY(const AABB & other) const;
 	bool collidesX(const AABB & other) const;
 	bool collides(const AABB & other) const;
+	bool intersects(const AABB & other) const;
 	void setMinP(const vec2 & minP);
 	void setMaxP(const vec2 & maxP);
 	AABB operator+(const vec2 & other) const;
 	AABB operator-(const vec2 & other) const;
 	AABB operator*(const float f) const;
 	AABB operator/(const float f) const;
+	AABB sweep(const vec2 & v) const;
 	vec2 getCenterP() const;
 	vec2 getMinP() const;
 	vec2 getMaxP() const;
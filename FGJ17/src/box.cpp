@@ -1,6 +1,6 @@
 #include "box.h"
 #include "game.h"
-#include "tile.h"
+#include "tilebitmap.h"
 
 // Box class
 Box::Box(
@@ -17,28 +17,25 @@ Box::Box(
 	m_triggered(false)
 {
 	// Choose box color
-	for (auto & prop : m_properties)
+	if (m_properties.has(PN_ID))
 	{
-		if (prop.first == EPN_ID)
+		switch (m_properties.id)
 		{
-			switch (prop.second.value_num)
-			{
-			case 0:
-				m_currentSprite = "BOX_RED";
-				break;
-			case 1:
-				m_currentSprite = "BOX_BLUE";
-				break;
-			case 2:
-				m_currentSprite = "BOX_GREEN";
-				break;
-			case 3:
-				m_currentSprite = "BOX_YELLOW";
-				break;
-			case 4:
-				m_currentSprite = "BOX_PURPLE";
-				break;
-			}
+		case 0:
+			m_currentSprite = "BOX_RED";
+			break;
+		case 1:
+			m_currentSprite = "BOX_BLUE";
+			break;
+		case 2:
+			m_currentSprite = "BOX_GREEN";
+			break;
+		case 3:
+			m_currentSprite = "BOX_YELLOW";
+			break;
+		case 4:
+			m_currentSprite = "BOX_PURPLE";
+			break;
 		}
 	}
 }
@@ -49,18 +46,15 @@ void Box::update(Level & lvl, double t, double dt)
 	bool triggered = false;
 
 	// Check for triggers around us
-	for (Tile * t : m_currentTileCollisions)
+	if (m_currentTileClasses & (1 << TC_TRIGGER))
 	{
-		if (t->hasPropertyWithValue(TPN_TYPE, TilePropertyValue(TPV_STRING, "TRIGGER", NULL)))
-		{
-			triggered = true;
+		triggered = true;
 
-			// This is a one shot signal
-			if (m_triggered == false)
-				LOG_INFO("Box: Box::update Detected collision with a trigger tile!");
+		// This is a one shot signal
+		if (m_triggered == false)
+			LOG_INFO("Box: Box::update Detected collision with a trigger tile!");
 
-			m_triggered = true;
-		}
+		m_triggered = true;
 	}
 
 	// Reset trigger information if no triggers nearby
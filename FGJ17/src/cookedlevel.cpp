@@ -0,0 +1,360 @@
+#include "cookedlevel.h"
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "macros.h"
+#include "mappedfile.h"
+#include "tmxmap.h"
+
+static uint32_t align4(size_t size)
+{
+	return static_cast<uint32_t>((size + 3) & ~static_cast<size_t>(3));
+}
+
+template<typename T>
+static void writeSection(std::ofstream & out, const std::vector<T> & items)
+{
+	const char padding[4] = { 0, 0, 0, 0 };
+	const size_t size = items.size() * sizeof(T);
+
+	if (size != 0)
+		out.write(reinterpret_cast<const char *>(items.data()), size);
+
+	out.write(padding, align4(size) - size);
+}
+
+// Cooked levels are read in place, so they have to come from a host of the
+// same byte order & record layout
+static bool isHostLayout(const CookedLevelHeader & header)
+{
+	return header.byteOrder == COOKED_LEVEL_BYTE_ORDER && header.layout == COOKED_LEVEL_LAYOUT;
+}
+
+template<typename T>
+static const T * readSection(const MappedFile & file, const CookedSection & section)
+{
+	if (section.offset % 4 != 0 || section.offset > file.getSize() || (file.getSize() - section.offset) / sizeof(T) < section.count)
+		return nullptr;
+
+	return reinterpret_cast<const T *>(file.getData() + section.offset);
+}
+
+// Cooks ./data/levels/<name>.tmx & .json into ./data/levels/<name>.lvl
+bool CookedLevel::cook(const std::string & name)
+{
+	const std::string tmxFilePath("./data/levels/" + name + ".tmx");
+	const std::string jsonFilePath("./data/levels/" + name + ".json");
+
+	std::ifstream jsonFile(jsonFilePath, std::ifstream::binary);
+	if (jsonFile.is_open() == false)
+	{
+		ERR("CookedLevel: Can't find JSON data for level (" << jsonFilePath << ")!");
+		return false;
+	}
+
+	std::stringstream levelJson;
+	levelJson << jsonFile.rdbuf();
+
+	// Map data only, tiles are built from the cooked level when it is loaded
+	TmxMap tmxMap(nullptr, tmxFilePath);
+	if (tmxMap.getMapData().layer.empty())
+	{
+		ERR("CookedLevel: Level (" << tmxFilePath << ") has no tile layers!");
+		return false;
+	}
+
+	return write(toCookedPath(tmxFilePath), tmxMap.getMapData(), levelJson.str());
+}
+
+bool CookedLevel::write(const std::string & filePath, const TmxMapData & mapData, const std::string & levelJson)
+{
+	std::string strings;
+	auto addString = [&](const std::string & str)
+	{
+		CookedString cstr = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size()) };
+		strings += str;
+		return cstr;
+	};
+
+	CookedLevelHeader header = {};
+	header.magic = COOKED_LEVEL_MAGIC;
+	header.version = COOKED_LEVEL_VERSION;
+	header.byteOrder = COOKED_LEVEL_BYTE_ORDER;
+	header.layout = COOKED_LEVEL_LAYOUT;
+	header.mapVersion = addString(mapData.version);
+	header.orientation = addString(mapData.orientation);
+	header.renderorder = addString(mapData.renderorder);
+	header.width = mapData.width;
+	header.height = mapData.height;
+	header.tilewidth = mapData.tilewidth;
+	header.tileheight = mapData.tileheight;
+	header.tileset = CookedTileset{
+		mapData.tileset.firstgid,
+		addString(mapData.tileset.name),
+		addString(mapData.tileset.source),
+		mapData.tileset.width,
+		mapData.tileset.height,
+		mapData.tileset.tilewidth,
+		mapData.tileset.tileheight
+	};
+	header.levelJson = addString(levelJson);
+
+	// Tile layers, their gids & the properties resolved per gid
+	std::vector<CookedLayer> layers;
+	std::vector<CookedTileProperties> tileProperties;
+	std::vector<uint32_t> gids;
+	for (auto & l : mapData.layer)
+	{
+		layers.push_back(CookedLayer{
+			addString(l.name),
+			l.width,
+			l.height,
+			static_cast<uint32_t>(gids.size()),
+			static_cast<uint32_t>(tileProperties.size()),
+			static_cast<uint32_t>(l.tileProperties.size())
+		});
+
+		gids.insert(gids.end(), l.gids.begin(), l.gids.end());
+		gids.resize(layers.back().firstGid + static_cast<size_t>(l.width) * l.height, 0);
+
+		for (auto & p : l.tileProperties)
+		{
+			tileProperties.push_back(CookedTileProperties{ p.first, p.second });
+		}
+	}
+
+	std::vector<CookedImgLayer> imgLayers;
+	for (auto & l : mapData.imglayer)
+	{
+		imgLayers.push_back(CookedImgLayer{ addString(l.name), addString(l.source) });
+	}
+
+	std::vector<CookedObjectGroup> objectGroups;
+	std::vector<CookedObject> objects;
+	for (auto & ogd : mapData.objectgroup)
+	{
+		objectGroups.push_back(CookedObjectGroup{
+			addString(ogd.name),
+			static_cast<uint32_t>(objects.size()),
+			static_cast<uint32_t>(ogd.objects.size())
+		});
+
+		for (auto & o : ogd.objects)
+		{
+			objects.push_back(CookedObject{ o.id, addString(o.name), addString(o.type), o.x, o.y, o.width, o.height, o.properties });
+		}
+	}
+
+	// Sections follow the header in this order
+	uint32_t offset = align4(sizeof(CookedLevelHeader));
+	auto place = [&](CookedSection & section, size_t count, size_t size)
+	{
+		section = CookedSection{ offset, static_cast<uint32_t>(count) };
+		offset += align4(count * size);
+	};
+	place(header.layers, layers.size(), sizeof(CookedLayer));
+	place(header.tileProperties, tileProperties.size(), sizeof(CookedTileProperties));
+	place(header.imgLayers, imgLayers.size(), sizeof(CookedImgLayer));
+	place(header.objectGroups, objectGroups.size(), sizeof(CookedObjectGroup));
+	place(header.objects, objects.size(), sizeof(CookedObject));
+	place(header.gids, gids.size(), sizeof(uint32_t));
+	place(header.strings, strings.size(), sizeof(char));
+
+	std::ofstream out(filePath, std::ofstream::binary | std::ofstream::trunc);
+	if (out.is_open() == false)
+	{
+		ERR("CookedLevel: Can't open (" << filePath << ") for writing!");
+		return false;
+	}
+
+	writeSection(out, std::vector<CookedLevelHeader>(1, header));
+	writeSection(out, layers);
+	writeSection(out, tileProperties);
+	writeSection(out, imgLayers);
+	writeSection(out, objectGroups);
+	writeSection(out, objects);
+	writeSection(out, gids);
+	writeSection(out, std::vector<char>(strings.begin(), strings.end()));
+
+	if (!out.good())
+	{
+		ERR("CookedLevel: Error writing (" << filePath << ")!");
+		return false;
+	}
+
+	LOG("CookedLevel: Cooked (" << filePath << "), " << offset << " bytes.");
+
+	return true;
+}
+
+bool CookedLevel::read(const std::string & filePath, TmxMapData & mapData, std::string & levelJson)
+{
+	MappedFile file(filePath);
+	if (!file.isOpen() || file.getSize() < sizeof(CookedLevelHeader))
+		return false;
+
+	const CookedLevelHeader & header = *reinterpret_cast<const CookedLevelHeader *>(file.getData());
+	if (header.magic != COOKED_LEVEL_MAGIC || header.version != COOKED_LEVEL_VERSION)
+	{
+		ERR("CookedLevel: File (" << filePath << ") is not a version " << COOKED_LEVEL_VERSION << " cooked level!");
+		return false;
+	}
+
+	if (!isHostLayout(header))
+	{
+		ERR("CookedLevel: File (" << filePath << ") was cooked for another byte order or ABI, cook it again on this host!");
+		return false;
+	}
+
+	const CookedLayer * layers = readSection<CookedLayer>(file, header.layers);
+	const CookedTileProperties * tileProperties = readSection<CookedTileProperties>(file, header.tileProperties);
+	const CookedImgLayer * imgLayers = readSection<CookedImgLayer>(file, header.imgLayers);
+	const CookedObjectGroup * objectGroups = readSection<CookedObjectGroup>(file, header.objectGroups);
+	const CookedObject * objects = readSection<CookedObject>(file, header.objects);
+	const uint32_t * gids = readSection<uint32_t>(file, header.gids);
+	const char * strings = readSection<char>(file, header.strings);
+
+	if (!layers || !tileProperties || !imgLayers || !objectGroups || !objects || !gids || !strings)
+	{
+		ERR("CookedLevel: File (" << filePath << ") is truncated!");
+		return false;
+	}
+
+	bool valid = true;
+	auto str = [&](const CookedString & cstr)
+	{
+		if (cstr.offset > header.strings.count || header.strings.count - cstr.offset < cstr.length)
+		{
+			valid = false;
+			return std::string();
+		}
+
+		return std::string(strings + cstr.offset, cstr.length);
+	};
+
+	mapData.version = str(header.mapVersion);
+	mapData.orientation = str(header.orientation);
+	mapData.renderorder = str(header.renderorder);
+	mapData.width = header.width;
+	mapData.height = header.height;
+	mapData.tilewidth = header.tilewidth;
+	mapData.tileheight = header.tileheight;
+	mapData.tileset.firstgid = header.tileset.firstgid;
+	mapData.tileset.name = str(header.tileset.name);
+	mapData.tileset.source = str(header.tileset.source);
+	mapData.tileset.width = header.tileset.width;
+	mapData.tileset.height = header.tileset.height;
+	mapData.tileset.tilewidth = header.tileset.tilewidth;
+	mapData.tileset.tileheight = header.tileset.tileheight;
+	levelJson = str(header.levelJson);
+
+	for (uint32_t i = 0; i < header.layers.count && valid; i++)
+	{
+		const CookedLayer & cl = layers[i];
+		const size_t n_gids = static_cast<size_t>(cl.width) * cl.height;
+
+		if (cl.firstGid > header.gids.count || header.gids.count - cl.firstGid < n_gids ||
+			cl.firstTileProperties > header.tileProperties.count || header.tileProperties.count - cl.firstTileProperties < cl.tilePropertiesCount)
+		{
+			valid = false;
+			break;
+		}
+
+		mapData.layer.push_back(TmxLayerData());
+		TmxLayerData & l = mapData.layer.back();
+		l.name = str(cl.name);
+		l.width = cl.width;
+		l.height = cl.height;
+		l.gids.assign(gids + cl.firstGid, gids + cl.firstGid + n_gids);
+
+		for (uint32_t p = 0; p < cl.tilePropertiesCount; p++)
+		{
+			const CookedTileProperties & ctp = tileProperties[cl.firstTileProperties + p];
+			l.tileProperties[ctp.gid] = ctp.properties;
+		}
+	}
+
+	for (uint32_t i = 0; i < header.imgLayers.count && valid; i++)
+	{
+		mapData.imglayer.push_back(TmxImgLayerData{ str(imgLayers[i].name), str(imgLayers[i].source) });
+	}
+
+	for (uint32_t i = 0; i < header.objectGroups.count && valid; i++)
+	{
+		const CookedObjectGroup & cog = objectGroups[i];
+
+		if (cog.firstObject > header.objects.count || header.objects.count - cog.firstObject < cog.objectCount)
+		{
+			valid = false;
+			break;
+		}
+
+		mapData.objectgroup.push_back(TmxObjectgroupData());
+		mapData.objectgroup.back().name = str(cog.name);
+
+		for (uint32_t o = 0; o < cog.objectCount; o++)
+		{
+			const CookedObject & co = objects[cog.firstObject + o];
+			mapData.objectgroup.back().objects.push_back(TmxObject{
+				co.id,
+				str(co.name),
+				str(co.type),
+				co.x,
+				co.y,
+				co.width,
+				co.height,
+				co.properties
+			});
+		}
+	}
+
+	if (!valid)
+	{
+		ERR("CookedLevel: File (" << filePath << ") is corrupt!");
+		return false;
+	}
+
+	return true;
+}
+
+// True if the file exists, was cooked for this host & none of the existing
+// sources is newer
+bool CookedLevel::isCurrent(const std::string & filePath, const std::vector<std::string> & sources)
+{
+	struct stat cookedStat;
+	if (stat(filePath.c_str(), &cookedStat) != 0)
+		return false;
+
+	CookedLevelHeader header = {};
+	std::ifstream cookedFile(filePath, std::ifstream::binary);
+	if (!cookedFile.read(reinterpret_cast<char *>(&header), sizeof(CookedLevelHeader)) ||
+		header.magic != COOKED_LEVEL_MAGIC || header.version != COOKED_LEVEL_VERSION || !isHostLayout(header))
+		return false;
+
+	for (const std::string & source : sources)
+	{
+		// mtimes are whole seconds, a source saved in the same second as the
+		// cook could be newer, so ties count as stale
+		struct stat sourceStat;
+		if (stat(source.c_str(), &sourceStat) == 0 && sourceStat.st_mtime >= cookedStat.st_mtime)
+			return false;
+	}
+
+	return true;
+}
+
+bool CookedLevel::isCookedPath(const std::string & filePath)
+{
+	return filePath.size() >= 4 && filePath.compare(filePath.size() - 4, 4, ".lvl") == 0;
+}
+
+std::string CookedLevel::toCookedPath(const std::string & filePath)
+{
+	const size_t dot = filePath.find_last_of('.');
+	const size_t slash = filePath.find_last_of("/\\");
+
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return filePath + ".lvl";
+
+	return filePath.substr(0, dot) + ".lvl";
+}
@@ -0,0 +1,137 @@
+#ifndef COOKEDLEVEL_H
+#define COOKEDLEVEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "properties.h"
+
+struct TmxMapData;
+
+// ---------------------------------------------------------------------------
+// Cooked level file layout
+// A .tmx map & its level JSON compiled into one binary file, read straight
+// from a memory mapping. Records are written as they are laid out in memory,
+// so a cooked level is not portable: it is only valid on a host with the
+// byte order & record layout of the one that cooked it, which the header
+// records. Properties are stored resolved, tile layers as packed gid arrays.
+// Sections are 4 byte aligned & their offsets are in bytes from the start of
+// the file. Strings are offsets & lengths into the string section, not NULL
+// terminated.
+// ---------------------------------------------------------------------------
+const uint32_t COOKED_LEVEL_MAGIC = 0x4C4A4746; // "FGJL"
+const uint32_t COOKED_LEVEL_VERSION = 2;
+
+// Reads back as another value on a host of the other byte order
+const uint32_t COOKED_LEVEL_BYTE_ORDER = 0x01020304;
+
+struct CookedString
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct CookedSection
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct CookedTileset
+{
+	uint32_t firstgid;
+	CookedString name;
+	CookedString source;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilewidth;
+	uint32_t tileheight;
+};
+
+struct CookedLevelHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t layout;
+	CookedString mapVersion;
+	CookedString orientation;
+	CookedString renderorder;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilewidth;
+	uint32_t tileheight;
+	CookedTileset tileset;
+	CookedString levelJson;
+	CookedSection layers;
+	CookedSection tileProperties;
+	CookedSection imgLayers;
+	CookedSection objectGroups;
+	CookedSection objects;
+	CookedSection gids;
+	CookedSection strings;
+};
+
+struct CookedLayer
+{
+	CookedString name;
+	uint32_t width;
+	uint32_t height;
+	uint32_t firstGid;
+	uint32_t firstTileProperties;
+	uint32_t tilePropertiesCount;
+};
+
+struct CookedTileProperties
+{
+	uint32_t gid;
+	Properties properties;
+};
+
+struct CookedImgLayer
+{
+	CookedString name;
+	CookedString source;
+};
+
+struct CookedObjectGroup
+{
+	CookedString name;
+	uint32_t firstObject;
+	uint32_t objectCount;
+};
+
+struct CookedObject
+{
+	uint32_t id;
+	CookedString name;
+	CookedString type;
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	Properties properties;
+};
+
+// Sizes of the records that hold more than plain words, one byte each
+const uint32_t COOKED_LEVEL_LAYOUT =
+	static_cast<uint32_t>(sizeof(CookedLevelHeader)) |
+	static_cast<uint32_t>(sizeof(CookedTileProperties)) << 8 |
+	static_cast<uint32_t>(sizeof(CookedObject)) << 16 |
+	static_cast<uint32_t>(sizeof(Properties)) << 24;
+
+// Writes, validates & reads cooked levels. Cooked levels sit next to their
+// .tmx as .lvl & are only used while newer than both of their sources & cooked
+// for this host.
+class CookedLevel
+{
+public:
+	static bool cook(const std::string & name);
+	static bool write(const std::string & filePath, const TmxMapData & mapData, const std::string & levelJson);
+	static bool read(const std::string & filePath, TmxMapData & mapData, std::string & levelJson);
+	static bool isCurrent(const std::string & filePath, const std::vector<std::string> & sources);
+	static bool isCookedPath(const std::string & filePath);
+	static std::string toCookedPath(const std::string & filePath);
+};
+
+#endif // COOKEDLEVEL_H
@@ -1,55 +1,185 @@
 #include "display.h"
 #include <SDL.h>
-#include <SDL_ttf.h>
 #include <cassert>
 #include "macros.h"
+#include "glyphatlas.h"
 
-Display::Display(std::string title, int32_t width, int32_t height, int32_t scale) :
+Display::Display(std::string title, int32_t width, int32_t height, int32_t scale, DisplayBackend backend) :
 	m_title(title),
 	m_width(width),
 	m_height(height),
 	m_scale(scale),
 	m_offset(0, 0),
+	m_offsetX(0),
+	m_offsetY(0),
+	m_backend(backend),
 	m_window(NULL),
-	m_renderer(NULL)
+	m_surface(NULL),
+	m_renderer(NULL),
+	m_frame(NULL),
+	m_target(NULL),
+	m_baseTarget(NULL),
+	m_windowView(),
+	m_baseView(),
+	m_batches(),
+	m_batchesUsed(0),
+	m_draws(0),
+	m_frameDraws(0)
 {
-	m_window = SDL_CreateWindow(
-		m_title.c_str(),
-		SDL_WINDOWPOS_CENTERED,
-		SDL_WINDOWPOS_CENTERED,
-		m_width,
-		m_height,
-		SDL_WINDOW_SHOWN
-	);
+	switch (m_backend)
+	{
+	case DB_SOFTWARE:
+		m_surface = SDL_CreateRGBSurfaceWithFormat(0, m_width, m_height, 32, SDL_PIXELFORMAT_RGBA32);
+		break;
+	case DB_NULL:
+		// Textures still need a renderer to be created with, nothing is drawn
+		m_surface = SDL_CreateRGBSurfaceWithFormat(0, 1, 1, 32, SDL_PIXELFORMAT_RGBA32);
+		break;
+	case DB_WINDOW:
+	default:
+		m_window = SDL_CreateWindow(
+			m_title.c_str(),
+			SDL_WINDOWPOS_CENTERED,
+			SDL_WINDOWPOS_CENTERED,
+			m_width,
+			m_height,
+			SDL_WINDOW_SHOWN
+		);
+		break;
+	}
+
+	if (m_window != NULL)
+		m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	else if (m_surface != NULL)
+		m_renderer = SDL_CreateSoftwareRenderer(m_surface);
 
-	m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	if (m_renderer == NULL)
+		ERR("Display: Renderer creation Error: " << SDL_GetError());
 
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, 0);
+
+	m_windowView = DisplayView{ m_width, m_height, m_scale, m_offset };
+	m_baseView = m_windowView;
+
+	// World is drawn at native resolution & upscaled once per frame
+	if (m_scale > 1 && getRenderTargetSupported())
+	{
+		m_frame = SDL_CreateTexture(
+			m_renderer,
+			SDL_PIXELFORMAT_RGBA8888,
+			SDL_TEXTUREACCESS_TARGET,
+			(m_width + m_scale - 1) / m_scale,
+			(m_height + m_scale - 1) / m_scale
+		);
+
+		if (m_frame == NULL)
+			ERR("Display: SDL_CreateTexture Error: " << SDL_GetError());
+	}
 }
 
 Display::~Display()
 {
+	if (m_frame != NULL)
+		SDL_DestroyTexture(m_frame);
+
 	SDL_DestroyRenderer(m_renderer);
-	SDL_DestroyWindow(m_window);
+
+	if (m_window != NULL)
+		SDL_DestroyWindow(m_window);
+
+	if (m_surface != NULL)
+		SDL_FreeSurface(m_surface);
 }
 
+// Starts a frame, drawing goes into the native resolution frame if there is one
 void Display::clear()
 {
+	if (m_frame != NULL)
+	{
+		int32_t w, h;
+		SDL_QueryTexture(m_frame, NULL, NULL, &w, &h);
+
+		setRenderTarget(NULL);
+		m_baseTarget = m_frame;
+		m_baseView = DisplayView{ w, h, 1, m_offset };
+		m_width = w;
+		m_height = h;
+		m_scale = 1;
+		m_target = m_frame;
+		snapOffset();
+		SDL_SetRenderTarget(m_renderer, m_frame);
+	}
+
+	if (m_backend != DB_NULL)
+		SDL_RenderClear(m_renderer);
+}
+
+// Upscales the frame onto the window, drawing after this is in window pixels
+void Display::resolve()
+{
+	setRenderTarget(NULL);
+
+	if (m_baseTarget == NULL)
+		return;
+
+	const SDL_Rect destRect = { 0, 0, m_width * m_windowView.scale, m_height * m_windowView.scale };
+
+	m_baseTarget = NULL;
+	m_baseView = DisplayView{ m_windowView.width, m_windowView.height, m_windowView.scale, m_offset };
+	m_width = m_baseView.width;
+	m_height = m_baseView.height;
+	m_scale = m_baseView.scale;
+	m_target = NULL;
+	snapOffset();
+
+	SDL_SetRenderTarget(m_renderer, NULL);
 	SDL_RenderClear(m_renderer);
+	SDL_RenderCopy(m_renderer, m_frame, NULL, &destRect);
 }
 
 void Display::render()
 {
-	SDL_RenderPresent(m_renderer);
+	resolve();
+	flush();
+
+	m_frameDraws = m_draws;
+	m_draws = 0;
+
+	if (m_backend != DB_NULL)
+		SDL_RenderPresent(m_renderer);
+}
+
+// Submits the queued quads, one draw call per run of quads sharing a
+// texture, in the order they were queued
+void Display::flush()
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	for (size_t i = 0; i < m_batchesUsed; i++)
+	{
+		DisplayBatch & batch = m_batches[i];
+
+		SDL_RenderGeometry(
+			m_renderer,
+			batch.texture,
+			batch.vertices.data(),
+			static_cast<int>(batch.vertices.size()),
+			batch.indices.data(),
+			static_cast<int>(batch.indices.size())
+		);
+
+		batch.vertices.clear();
+		batch.indices.clear();
+	}
+
+	m_batchesUsed = 0;
+#endif
 }
 
-void Display::drawImage(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_Rect * destRect, const vec2 & destPos, bool clip)
+// The destination rect is given in world pixels, its position at the bottom
+// left corner, and is turned into the screen rect
+void Display::drawImage(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_Rect * destRect, bool clip)
 {
-	destRect->x = static_cast<int32_t>(std::round((destPos.x + m_offset.x) * m_scale));
-	destRect->y = static_cast<int32_t>(std::round((destPos.y + m_offset.y) * -m_scale));
-	destRect->w = static_cast<int32_t>(std::round(destRect->w * m_scale));
-	destRect->h = static_cast<int32_t>(std::round(destRect->h * m_scale));
-	destRect->y -= destRect->h;
+	toScreen(*destRect);
 
 	if (clip)
 	{
@@ -58,16 +188,12 @@ void Display::drawImage(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_Rect *
 			return;
 	}
 
-	SDL_RenderCopy(m_renderer, texture, sourceRect, destRect);
+	queueImage(texture, *sourceRect, *destRect);
 }
 
-void Display::drawImageRepeat(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_Rect * destRect, const vec2 & destPos, int32_t w, int32_t h, bool clip)
+void Display::drawImageRepeat(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_Rect * destRect, int32_t w, int32_t h, bool clip)
 {
-	destRect->x = static_cast<int32_t>(std::round((destPos.x + m_offset.x) * m_scale));
-	destRect->y = static_cast<int32_t>(std::round((destPos.y + m_offset.y) * -m_scale));
-	destRect->w = static_cast<int32_t>(std::round(destRect->w * m_scale));
-	destRect->h = static_cast<int32_t>(std::round(destRect->h * m_scale));
-	destRect->y -= destRect->h;
+	toScreen(*destRect);
 
 	int32_t ix = sourceRect->x;
 	int32_t iy = sourceRect->y;
@@ -88,54 +214,205 @@ void Display::drawImageRepeat(SDL_Texture * texture, SDL_Rect * sourceRect, SDL_
 				ty < -destRecti.h || ty > m_height)
 				continue;
 
-			SDL_RenderCopy(m_renderer, texture, sourceRect, &destRecti);
+			queueImage(texture, *sourceRect, destRecti);
 		}
 	}
 }
 
-void Display::drawText(TTF_Font * font, const std::string & text, SDL_Color color, const vec2 & destPos)
+// Text is drawn in window pixels, one batched quad per glyph
+void Display::drawText(GlyphAtlas * const atlas, const std::string & text, SDL_Color color, const vec2 & destPos)
 {
-	assert(font);
+	assert(atlas);
 
-	SDL_Surface * surface = TTF_RenderText_Blended(font, text.c_str(), color);
-	SDL_Texture * texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+	SDL_Texture * texture = atlas->getTexture();
+	if (texture == NULL)
+		return;
 
-	SDL_Rect destRect;
-	destRect.x = static_cast<int32_t>(destPos.x);
-	destRect.y = static_cast<int32_t>(destPos.y);
-	SDL_QueryTexture(texture, NULL, NULL, &destRect.w, &destRect.h);
-	SDL_RenderCopy(m_renderer, texture, NULL, &destRect);
+	int32_t x = static_cast<int32_t>(destPos.x);
+	const int32_t y = static_cast<int32_t>(destPos.y);
+
+	for (char c : text)
+	{
+		const GlyphInfo * const glyph = atlas->getGlyph(c);
+		const SDL_Rect destRect = { x, y, glyph->srcRect.w, glyph->srcRect.h };
+
+		if (glyph->srcRect.w > 0)
+			queueImage(texture, glyph->srcRect, destRect, color);
 
-	SDL_FreeSurface(surface);
-	SDL_DestroyTexture(texture);
+		x += glyph->advance;
+	}
 }
 
 void Display::drawRectangle(const vec2 & tl, const vec2 & br)
 {
 	SDL_Rect destRect;
-	destRect.x = static_cast<int32_t>(std::round((tl.x + m_offset.x) * m_scale));
-	destRect.y = static_cast<int32_t>(std::round((tl.y + m_offset.y) * -m_scale));
-	destRect.w = static_cast<int32_t>(std::round(std::abs(tl.x - br.x) * m_scale));
-	destRect.h = static_cast<int32_t>(std::round(std::abs(tl.y - br.y) * m_scale));
-	destRect.y -= destRect.h;
+	destRect.x = static_cast<int32_t>(std::round(tl.x));
+	destRect.y = static_cast<int32_t>(std::round(tl.y));
+	destRect.w = static_cast<int32_t>(std::round(std::abs(tl.x - br.x)));
+	destRect.h = static_cast<int32_t>(std::round(std::abs(tl.y - br.y)));
+	toScreen(destRect);
+
+	m_draws++;
+	if (m_backend == DB_NULL)
+		return;
 
+	flush();
 	SDL_RenderDrawRect(m_renderer, &destRect);
 }
 
+SDL_Texture * Display::createRenderTarget(int32_t w, int32_t h)
+{
+	SDL_Texture * texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+
+	if (texture == NULL)
+	{
+		ERR("Display: SDL_CreateTexture Error: " << SDL_GetError());
+		return NULL;
+	}
+
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	return texture;
+}
+
+// Draws go into the target at scale 1, origin being the world position of
+// the target's bottom left corner. The target is cleared to transparent.
+// NULL restores drawing to the frame, or the window outside of a frame.
+void Display::setRenderTarget(SDL_Texture * target, const vec2 & origin)
+{
+	// Queued quads belong to the current target
+	flush();
+
+	if (target == NULL)
+	{
+		if (m_target != m_baseTarget)
+		{
+			m_width = m_baseView.width;
+			m_height = m_baseView.height;
+			m_scale = m_baseView.scale;
+			m_offset = m_baseView.offset;
+			m_target = m_baseTarget;
+			snapOffset();
+			SDL_SetRenderTarget(m_renderer, m_baseTarget);
+		}
+
+		return;
+	}
+
+	if (m_target == m_baseTarget)
+		m_baseView = DisplayView{ m_width, m_height, m_scale, m_offset };
+
+	m_target = target;
+	SDL_QueryTexture(m_target, NULL, NULL, &m_width, &m_height);
+	m_scale = 1;
+	m_offset = vec2(-origin.x, -origin.y - m_height);
+	snapOffset();
+
+	SDL_SetRenderTarget(m_renderer, m_target);
+
+	Uint8 r, g, b, a;
+	SDL_GetRenderDrawColor(m_renderer, &r, &g, &b, &a);
+	SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+	SDL_RenderClear(m_renderer);
+	SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
+}
+
+// Snaps the offset to whole screen pixels once, for every draw until the
+// offset or the scale changes
+void Display::snapOffset()
+{
+	m_offsetX = static_cast<int32_t>(std::round(m_offset.x * m_scale));
+	m_offsetY = static_cast<int32_t>(std::round(m_offset.y * -m_scale));
+}
+
+// World pixels to screen pixels, y up to y down
+void Display::toScreen(SDL_Rect & rect) const
+{
+	if (m_scale != 1)
+	{
+		rect.x *= m_scale;
+		rect.y *= m_scale;
+		rect.w *= m_scale;
+		rect.h *= m_scale;
+	}
+
+	rect.x += m_offsetX;
+	rect.y = m_offsetY - rect.y - rect.h;
+}
+
+void Display::queueImage(SDL_Texture * texture, const SDL_Rect & sourceRect, const SDL_Rect & destRect, SDL_Color color)
+{
+	m_draws++;
+	if (m_backend == DB_NULL)
+		return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// Only consecutive quads of one texture share a batch, so the quads of
+	// a texture switched away from & back to still draw over the quads
+	// queued in between
+	DisplayBatch * batch = (m_batchesUsed > 0 && m_batches[m_batchesUsed - 1].texture == texture) ? &m_batches[m_batchesUsed - 1] : nullptr;
+
+	// Batch slots & their vertex storage are reused between flushes
+	if (batch == nullptr)
+	{
+		if (m_batchesUsed == m_batches.size())
+			m_batches.push_back(DisplayBatch());
+
+		int w, h;
+		SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+
+		batch = &m_batches[m_batchesUsed++];
+		batch->texture = texture;
+		batch->invWidth = 1.0f / w;
+		batch->invHeight = 1.0f / h;
+	}
+
+	const float x0 = static_cast<float>(destRect.x);
+	const float y0 = static_cast<float>(destRect.y);
+	const float x1 = static_cast<float>(destRect.x + destRect.w);
+	const float y1 = static_cast<float>(destRect.y + destRect.h);
+	const float u0 = sourceRect.x * batch->invWidth;
+	const float v0 = sourceRect.y * batch->invHeight;
+	const float u1 = (sourceRect.x + sourceRect.w) * batch->invWidth;
+	const float v1 = (sourceRect.y + sourceRect.h) * batch->invHeight;
+	const int base = static_cast<int>(batch->vertices.size());
+
+	batch->vertices.push_back(SDL_Vertex{ { x0, y0 }, color, { u0, v0 } });
+	batch->vertices.push_back(SDL_Vertex{ { x1, y0 }, color, { u1, v0 } });
+	batch->vertices.push_back(SDL_Vertex{ { x1, y1 }, color, { u1, v1 } });
+	batch->vertices.push_back(SDL_Vertex{ { x0, y1 }, color, { u0, v1 } });
+
+	const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i : quad)
+	{
+		batch->indices.push_back(base + i);
+	}
+#else
+	// No vertex submission before SDL 2.0.18
+	SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+	SDL_SetTextureAlphaMod(texture, color.a);
+	SDL_RenderCopy(m_renderer, texture, &sourceRect, &destRect);
+#endif
+}
+
 void Display::setState(uint32_t flags)
 {
-	SDL_SetWindowFullscreen(m_window, flags);
+	if (m_window != NULL)
+		SDL_SetWindowFullscreen(m_window, flags);
 }
 
 void Display::setTitle(const std::string & title)
 {
 	m_title = title;
-	SDL_SetWindowTitle(m_window, m_title.c_str());
+
+	if (m_window != NULL)
+		SDL_SetWindowTitle(m_window, m_title.c_str());
 }
 
 void Display::setOffset(const vec2 & offset)
 {
 	m_offset = vec2(offset.x, offset.y);
+	snapOffset();
 }
 
 std::string Display::getTitle() const
@@ -163,6 +440,30 @@ vec2 Display::getOffset() const
 	return m_offset;
 }
 
+// World area visible through the current offset & scale
+AABB Display::getView() const
+{
+	const vec2 minP(-m_offset.x, -m_offset.y - static_cast<float>(m_height) / m_scale);
+	return AABB(minP, minP + vec2(static_cast<float>(m_width), static_cast<float>(m_height)) / static_cast<float>(m_scale));
+}
+
+DisplayBackend Display::getBackend() const
+{
+	return m_backend;
+}
+
+// Quads & rectangles drawn during the last presented frame
+size_t Display::getFrameDraws() const
+{
+	return m_frameDraws;
+}
+
+// Null backend draws tiles one by one so its draw counts match a real frame
+bool Display::getRenderTargetSupported() const
+{
+	return m_backend != DB_NULL && SDL_RenderTargetSupported(m_renderer) == SDL_TRUE;
+}
+
 SDL_Renderer * const Display::getRenderer() const
 {
 	return m_renderer;
@@ -2,14 +2,24 @@
 #define DISPLAY_H
 
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <SDL.h>
+#include "tools.h"
 #include "vec2.h"
+#include "aabb.h"
 
-typedef struct SDL_Window SDL_Window;
-typedef struct SDL_Renderer SDL_Renderer;
-typedef struct SDL_Texture SDL_Texture;
-typedef struct SDL_Rect SDL_Rect;
-typedef struct SDL_Color SDL_Color;
-typedef struct _TTF_Font TTF_Font;
+class GlyphAtlas;
+
+// Window is the accelerated, vsync'd renderer on a shown window. Software
+// renders into an SDL_Surface and Null counts draws without drawing them,
+// neither opens a window so both run under SDL_VIDEODRIVER=dummy.
+enum DisplayBackend : uint8_t
+{
+	DB_WINDOW = 0,
+	DB_SOFTWARE = 1,
+	DB_NULL = 2
+};
 
 class Display
 {
@@ -18,29 +28,30 @@ public:
 		std::string title = "null",
 		int32_t width = 512,
 		int32_t height = 480,
-		int32_t scale = 3
+		int32_t scale = 3,
+		DisplayBackend backend = DB_WINDOW
 	);
 	~Display();
 	void clear();
+	void resolve();
 	void render();
+	void flush();
 	void drawImage(
 		SDL_Texture * texture,
 		SDL_Rect * sourceRect,
 		SDL_Rect * destRect,
-		const vec2 & destPos,
 		bool clip = false
 	);
 	void drawImageRepeat(
 		SDL_Texture * texture,
 		SDL_Rect * sourceRect,
 		SDL_Rect * destRect,
-		const vec2 & destPos,
 		int32_t w,
 		int32_t h,
 		bool clip = false
 	);
 	void drawText(
-		TTF_Font * font,
+		GlyphAtlas * const atlas,
 		const std::string & text,
 		SDL_Color color,
 		const vec2 & destPos
@@ -49,6 +60,8 @@ public:
 		const vec2 & tl,
 		const vec2 & br
 	);
+	SDL_Texture * createRenderTarget(int32_t w, int32_t h);
+	void setRenderTarget(SDL_Texture * target, const vec2 & origin = vec2(0, 0));
 	void setState(uint32_t flags);
 	void setTitle(const std::string & title);
 	void setOffset(const vec2 & offset);
@@ -57,15 +70,73 @@ public:
 	int32_t getHeight() const;
 	int32_t getScale() const;
 	vec2 getOffset() const;
+	AABB getView() const;
+	DisplayBackend getBackend() const;
+	size_t getFrameDraws() const;
+	bool getRenderTargetSupported() const;
 	SDL_Renderer * const getRenderer() const;
+
+	static DisplayBackend strToBackend(const std::string & str)
+	{
+		// Transform str to uppercase
+		std::string strUpper = str;
+		std::transform(strUpper.begin(), strUpper.end(), strUpper.begin(), ::toupper);
+
+		switch (cstr2int(strUpper.c_str()))
+		{
+		case cstr2int("SOFTWARE"):
+			return DB_SOFTWARE;
+		case cstr2int("NULL"):
+			return DB_NULL;
+		case cstr2int("WINDOW"):
+		default:
+			return DB_WINDOW;
+		}
+	}
 private:
+	void snapOffset();
+	void toScreen(SDL_Rect & rect) const;
+	void queueImage(SDL_Texture * texture, const SDL_Rect & sourceRect, const SDL_Rect & destRect, SDL_Color color = SDL_Color{ 255, 255, 255, 255 });
+
+	// Run of consecutively queued quads of one texture, submitted by flush()
+	struct DisplayBatch
+	{
+		SDL_Texture * texture;
+		float invWidth;
+		float invHeight;
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+	};
+
+	// View of the frame or window target, saved while drawing into a render target
+	struct DisplayView
+	{
+		int32_t width;
+		int32_t height;
+		int32_t scale;
+		vec2 offset;
+	};
+
 	std::string m_title;
 	int32_t m_width;
 	int32_t m_height;
 	int32_t m_scale;
 	vec2 m_offset;
+	int32_t m_offsetX;
+	int32_t m_offsetY;
+	DisplayBackend m_backend;
 	SDL_Window * m_window;
+	SDL_Surface * m_surface;
 	SDL_Renderer * m_renderer;
+	SDL_Texture * m_frame;
+	SDL_Texture * m_target;
+	SDL_Texture * m_baseTarget;
+	DisplayView m_windowView;
+	DisplayView m_baseView;
+	std::vector<DisplayBatch> m_batches;
+	size_t m_batchesUsed;
+	size_t m_draws;
+	size_t m_frameDraws;
 };
 
 #endif // DISPLAY_H
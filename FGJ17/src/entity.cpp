@@ -6,6 +6,7 @@
 #include "display.h"
 #include "level.h"
 #include "tile.h"
+#include "tilebitmap.h"
 
 Entity::Entity(
 	Game * const game,
@@ -18,11 +19,12 @@ Entity::Entity(
 	m_name(name),
 	m_spriteSheet(),
 	m_currentSprite("NULL"),
-	m_currentTileCollisions(),
+	m_currentTileClasses(0),
 	m_currentEntityCollisions(),
 	m_initAABB(),
 	m_physAABB(),
 	m_spawn(spawn),
+	m_prevPosition(spawn),
 	m_position(spawn),
 	m_velocity(),
 	m_airFriction(0.05f),
@@ -90,6 +92,10 @@ Entity::Entity(
 		// Insert the new sprite into our spriteSheet
 		m_spriteSheet.emplace(name, Sprite(game->getResMan()->loadTexture(spriteSheet), animFrames, animRepeat, animRate));
 	}
+
+	// Place the physics AABB at spawn, the level broadphase & camera read it
+	// before the first update
+	m_physAABB = m_initAABB + m_spawn;
 }
 
 void Entity::update(Level & lvl, double t, double dt)
@@ -98,6 +104,9 @@ void Entity::update(Level & lvl, double t, double dt)
 	if (!lvl.getAABB().collidesYUp(m_physAABB))
 		m_position = m_spawn;
 
+	// Rendering interpolates from here, teleports included
+	m_prevPosition = m_position;
+
 	// Movement dir X
 	if (m_velocity.x <= EPSILON && m_velocity.x >= -EPSILON)
 		m_moveDirX = ENTITY_STATIONARY_X;
@@ -140,126 +149,133 @@ void Entity::update(Level & lvl, double t, double dt)
 	}
 
 	// Clear current collision vectors
-	m_currentTileCollisions.clear();
 	m_currentEntityCollisions.clear();
 
-	// Collision against tiles
-	// TODO: Fix entity getting stuck at corners
-	std::vector<Tile *> nearbyTiles;
-	if (lvl.getTileGrid()->getNearestData(m_physAABB.getCenterP(), m_game->getPhysicsDistance(), nearbyTiles))
-	{
-		AABB aabb_vx(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_vx = aabb_vx + vec2(m_velocity.x * static_cast<float>(dt), 0.0f);
-		AABB aabb_vy(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_vy = aabb_vy + vec2(0.0f, m_velocity.y * static_cast<float>(dt));
-		AABB aabb_v(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_v = aabb_vx + vec2(m_velocity.x * static_cast<float>(dt), m_velocity.y * static_cast<float>(dt));
-
-		for (Tile * t : nearbyTiles)
-		{
-			// Update current tile collisions vector against this entity
-			if (m_physAABB.collides(t->getAABB()))
-				m_currentTileCollisions.push_back(t);
+	// Swept AABBs for this tick
+	AABB aabb_vx(m_physAABB.getMinP(), m_physAABB.getMaxP());
+	aabb_vx = aabb_vx + vec2(m_velocity.x * static_cast<float>(dt), 0.0f);
+	AABB aabb_vy(m_physAABB.getMinP(), m_physAABB.getMaxP());
+	aabb_vy = aabb_vy + vec2(0.0f, m_velocity.y * static_cast<float>(dt));
 
-			// Physics collisions below
-			if (!t->hasPropertyWithValue(TPN_TYPE, TilePropertyValue(TPV_STRING, "SOLID", NULL)))
-				continue;
+	// Classes of the tiles this entity is touching
+	const TileBitmap * tileBitmap = lvl.getTileBitmap();
+	m_currentTileClasses = tileBitmap->getClasses(m_physAABB);
 
-			bool inAir = false;
+	// Collision against solid tiles touching the swept AABB
+	// TODO: Fix entity getting stuck at corners
+	tileBitmap->visit(m_physAABB.sweep(m_velocity * static_cast<float>(dt)), TC_SOLID, [&](int32_t tx, int32_t ty)
+	{
+		const AABB t = tileBitmap->getTileAABB(tx, ty);
+		bool inAir = false;
 
-			if (m_physAABB.collidesY(t->getAABB()))
+		if (m_physAABB.collidesY(t))
+		{
+			if (aabb_vx.collidesX(t))
 			{
-				if (aabb_vx.collidesX(t->getAABB()))
-				{
-					m_velocity.x -= m_velocity.x;
-				}
-				else if (m_velocity.y != 0.0f)
-				{
-					inAir = true;
-				}
+				m_velocity.x -= m_velocity.x;
 			}
-
-			if (m_physAABB.collidesX(t->getAABB()))
+			else if (m_velocity.y != 0.0f)
 			{
-				if (aabb_vy.collidesY(t->getAABB()))
-				{
-					if (aabb_vy.collidesYDown(t->getAABB()) && m_velocity.y < 0.0f)
-					{
-						m_state = ENTITY_GROUNDED;
-					}
+				inAir = true;
+			}
+		}
 
-					m_velocity.y -= m_velocity.y;
-				}
-				else
+		if (m_physAABB.collidesX(t))
+		{
+			if (aabb_vy.collidesY(t))
+			{
+				if (aabb_vy.collidesYDown(t) && m_velocity.y < 0.0f)
 				{
-					inAir = inAir && true;
+					m_state = ENTITY_GROUNDED;
 				}
-			}
 
-			m_state = inAir ? ENTITY_FLYING : m_state;
+				m_velocity.y -= m_velocity.y;
+			}
+			else
+			{
+				inAir = inAir && true;
+			}
 		}
-	}
 
-	// Collision against entities
-	std::vector<Entity *> nearbyEntities;
-	if (lvl.getEntityGrid()->getNearestData(m_physAABB.getCenterP(), m_game->getPhysicsDistance(), nearbyEntities))
+		m_state = inAir ? ENTITY_FLYING : m_state;
+	});
+
+	// Only tiles touching the swept AABB are visited above, so a ledge walked
+	// off is out of reach a tick later. Nothing stopped the fall & no solid
+	// tile in the pixel below the feet means airborne. Entities standing on
+	// other entities are grounded again when their pair is resolved.
+	if (m_velocity.y != 0.0f && m_state == ENTITY_GROUNDED)
 	{
-		AABB aabb_vx(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_vx = aabb_vx + vec2(m_velocity.x * static_cast<float>(dt), 0.0f);
-		AABB aabb_vy(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_vy = aabb_vy + vec2(0.0f, m_velocity.y * static_cast<float>(dt));
-		AABB aabb_v(m_physAABB.getMinP(), m_physAABB.getMaxP());
-		aabb_v = aabb_vx + vec2(m_velocity.x * static_cast<float>(dt), m_velocity.y * static_cast<float>(dt));
-
-		for (Entity * e : nearbyEntities)
+		const AABB below(
+			vec2(m_physAABB.getMinP().x, m_physAABB.getMinP().y - 1.0f),
+			vec2(m_physAABB.getMaxP().x, m_physAABB.getMinP().y - 0.5f)
+		);
+		bool supported = false;
+
+		tileBitmap->visit(below, TC_SOLID, [&](int32_t, int32_t)
 		{
-			// Skip instance of self
-			if (e == this)
-				continue;
+			supported = true;
+		});
 
-			// Update current entity collisions vector against this entity
-			if (m_physAABB.collides(e->getPhysAABB()))
-				m_currentEntityCollisions.push_back(e);
+		if (!supported)
+			m_state = ENTITY_FLYING;
+	}
+}
 
-			// Physics collisions below
-			if (!e->hasPropertyWithValue(EPN_TYPE, EntityPropertyValue(EPV_STRING, "SOLID", NULL)))
-				continue;
+void Entity::resolveCollision(Entity & a, Entity & b, double dt)
+{
+	// Both sides see the velocities from before the pair was resolved
+	const vec2 va = a.m_velocity;
+	const vec2 vb = b.m_velocity;
 
-			bool inAir = false;
+	a.resolveAgainst(b, va, dt);
+	b.resolveAgainst(a, vb, dt);
+}
 
-			if (m_physAABB.collidesY(e->getPhysAABB()))
-			{
-				if (aabb_vx.collidesX(e->getPhysAABB()))
-				{
-					e->applyForce(vec2(m_velocity.x * 0.5f, 0.0f));
-					m_velocity.x *= 0.5f;
-				}
-				else if (m_velocity.y != 0.0f)
-				{
-					inAir = true;
-				}
-			}
+void Entity::resolveAgainst(Entity & e, const vec2 & v, double dt)
+{
+	// Swept AABBs of this entity
+	const AABB aabb_vx = m_physAABB + vec2(v.x * static_cast<float>(dt), 0.0f);
+	const AABB aabb_vy = m_physAABB + vec2(0.0f, v.y * static_cast<float>(dt));
 
-			if (m_physAABB.collidesX(e->getPhysAABB()))
-			{
-				if (aabb_vy.collidesY(e->getPhysAABB()))
-				{
-					if (aabb_vy.collidesYDown(e->getPhysAABB()) && m_velocity.y < 0.0f)
-					{
-						m_state = ENTITY_GROUNDED;
-					}
+	// Pairs are only resolved when the swept AABBs overlap, so every entity
+	// resolved against counts as a current collision
+	m_currentEntityCollisions.push_back(&e);
 
-					m_velocity.y -= m_velocity.y;
-				}
-				else
-				{
-					inAir = inAir && true;
-				}
+	// Physics collisions below
+	if (!e.m_properties.hasType(PT_SOLID))
+		return;
+
+	bool inAir = false;
+
+	if (m_physAABB.collidesY(e.m_physAABB))
+	{
+		if (aabb_vx.collidesX(e.m_physAABB))
+		{
+			// Additive, so the order the two sides are resolved in doesn't matter
+			e.applyForce(vec2(v.x * 0.5f, 0.0f));
+			m_velocity.x -= v.x * 0.5f;
+		}
+		else if (v.y != 0.0f)
+		{
+			inAir = true;
+		}
+	}
+
+	if (m_physAABB.collidesX(e.m_physAABB))
+	{
+		if (aabb_vy.collidesY(e.m_physAABB))
+		{
+			if (aabb_vy.collidesYDown(e.m_physAABB) && v.y < 0.0f)
+			{
+				m_state = ENTITY_GROUNDED;
 			}
 
-			m_state = inAir ? ENTITY_FLYING : m_state;
+			m_velocity.y = 0.0f;
 		}
 	}
+
+	m_state = inAir ? ENTITY_FLYING : m_state;
 }
 
 void Entity::render(Display * const display)
@@ -267,6 +283,11 @@ void Entity::render(Display * const display)
 	getCurrentSprite().render(display, m_position);
 }
 
+void Entity::renderSnapshot(Display * const display, const EntitySnapshot & snapshot, float alpha)
+{
+	snapshot.sprite->render(display, snapshot.lerpPosition(alpha), snapshot.frame);
+}
+
 void Entity::renderAABB(Display * const display)
 {
 	SDL_SetRenderDrawColor(display->getRenderer(), 0, 255, 255, 255);
@@ -312,14 +333,20 @@ Sprite & Entity::getCurrentSprite()
 	return m_spriteSheet.at(m_currentSprite);
 }
 
+EntitySnapshot Entity::getSnapshot()
+{
+	const Sprite & sprite = getCurrentSprite();
+	return EntitySnapshot{ &sprite, sprite.getSprAnimFrame(), m_prevPosition, m_position, sprite.getDimensions() };
+}
+
 std::string Entity::getCurrentSpriteKey() const
 {
 	return m_currentSprite;
 }
 
-std::vector<Tile *> Entity::getCurrentTileCollisions() const
+uint32_t Entity::getCurrentTileClasses() const
 {
-	return m_currentTileCollisions;
+	return m_currentTileClasses;
 }
 
 std::vector<Entity *> Entity::getCurrentEntityCollisions() const
@@ -382,25 +409,7 @@ EntityMoveDirY Entity::getMoveDirY() const
 	return m_moveDirY;
 }
 
-bool Entity::hasPropertyWithValue(EntityPropertyName prop_name, EntityPropertyValue prop_value) const
+const EntityProperties & Entity::getProperties() const
 {
-	for (auto & prop : m_properties)
-	{
-		if (prop.first == prop_name)
-		{
-			switch (prop.second.type)
-			{
-			case EPV_STRING:
-				if (prop.second.value_str == prop_value.value_str)
-					return true;
-				break;
-			case EPV_NUMBER:
-				if (prop.second.value_num == prop_value.value_num)
-					return true;
-				break;
-			}
-		}
-	}
-
-	return false;
-}
\ No newline at end of file
+	return m_properties;
+}
@@ -7,6 +7,7 @@
 #include "macros.h"
 #include "sprite.h"
 #include "tmxobject.h"
+#include "properties.h"
 #include "vec2.h"
 #include "aabb.h"
 
@@ -27,42 +28,6 @@ struct EntityInput
 	bool keyB;
 };
 
-enum EntityPropertyName : uint8_t
-{
-	EPN_TYPE = 0,
-	EPN_ID = 1,
-	EPN_TARGET = 2,
-	EPN_TYPE_CUSTOM = 3,
-	EPN_ID_CUSTOM = 4,
-	EPN_TARGET_CUSTOM = 5
-};
-
-enum EntityPropertyValue_t : uint8_t
-{
-	EPV_NULL = 0,
-	EPV_STRING = 1,
-	EPV_NUMBER = 2
-};
-
-struct EntityPropertyValue
-{
-	EntityPropertyValue_t type;
-	std::string value_str;
-	int32_t value_num;
-
-	EntityPropertyValue(
-		EntityPropertyValue_t type = EPV_NULL,
-		std::string value_str = "NULL",
-		int32_t value_num = NULL
-	) :
-		type(type),
-		value_str(value_str),
-		value_num(value_num)
-	{
-
-	}
-};
-
 enum EntityState : uint8_t
 {
 	ENTITY_GROUNDED = 0,
@@ -83,8 +48,23 @@ enum EntityMoveDirY : uint8_t
 	ENTITY_STATIONARY_Y = 2
 };
 
-typedef std::pair<EntityPropertyName, EntityPropertyValue> EntityProperty;
-typedef std::vector<EntityProperty> EntityProperties;
+typedef Properties EntityProperties;
+
+// Render state of an entity, captured once per tick
+struct EntitySnapshot
+{
+	const Sprite * sprite;
+	int32_t frame;
+	vec2 prevPosition;
+	vec2 position;
+	vec2 dimensions;
+
+	// Position between the previous & the current tick
+	vec2 lerpPosition(float alpha) const
+	{
+		return prevPosition + (position - prevPosition) * alpha;
+	}
+};
 
 class Entity
 {
@@ -98,13 +78,16 @@ public:
 	virtual void update(Level & lvl, double t, double dt);
 	virtual void render(Display * const display);
 	virtual void renderAABB(Display * const display);
+	static void renderSnapshot(Display * const display, const EntitySnapshot & snapshot, float alpha = 1.0f);
+	static void resolveCollision(Entity & a, Entity & b, double dt);
 	void setCurrentSprite(const std::string & key, double sprAnimTime, int32_t sprAnimFrame);
 	void applyForce(const vec2 & F);
 	std::string getName() const;
 	std::map<std::string, Sprite> getSpriteSheet() const;
 	Sprite & getCurrentSprite();
+	EntitySnapshot getSnapshot();
 	std::string getCurrentSpriteKey() const;
-	std::vector<Tile *> getCurrentTileCollisions() const;
+	uint32_t getCurrentTileClasses() const;
 	std::vector<Entity *> getCurrentEntityCollisions() const;
 	AABB getInitAABB() const;
 	AABB getPhysAABB() const;
@@ -117,106 +100,22 @@ public:
 	EntityState getState() const;
 	EntityMoveDirX getMoveDirX() const;
 	EntityMoveDirY getMoveDirY() const;
-	bool hasPropertyWithValue(EntityPropertyName prop_name, EntityPropertyValue prop_value) const;
-
-	static EntityProperties strToProperties(const TmxObjectPropertiesData & tmxProps)
-	{
-		// Initialize entity properties vector
-		EntityProperties props;
-
-		for (auto & tmxProp : tmxProps)
-		{
-			// Initialize entity property object
-			EntityProperty prop;
-
-			// Get name & transform to uppercase
-			std::string prop_name = tmxProp.first;
-			std::transform(prop_name.begin(), prop_name.end(), prop_name.begin(), ::toupper);
-
-			// Convert string name to entity property name
-			switch (cstr2int(prop_name.c_str()))
-			{
-			case cstr2int("TYPE"):
-				prop.first = EPN_TYPE;
-				break;
-			case cstr2int("ID"):
-				prop.first = EPN_ID;
-				break;
-			case cstr2int("TARGET"):
-				prop.first = EPN_TARGET;
-				break;
-			case cstr2int("TYPE_CUSTOM"):
-				prop.first = EPN_TYPE_CUSTOM;
-				break;
-			case cstr2int("ID_CUSTOM"):
-				prop.first = EPN_ID_CUSTOM;
-				break;
-			case cstr2int("TARGET_CUSTOM"):
-				prop.first = EPN_TARGET_CUSTOM;
-				break;
-			default:
-				LOG_ERROR("Entity: Unknown entity property name: %s! Parsing properties interrupted.", prop_name.c_str());
-				return props;
-			}
-
-			// Convert string value to entity property value properly
-			if (prop.first == EPN_ID || prop.first == EPN_TARGET)
-			{
-				// Get value as integer
-				int32_t prop_value = std::stoi(tmxProp.second);
-				prop.second = EntityPropertyValue(EPV_NUMBER, "NULL", prop_value);
-			}
-			else
-			{
-				// Get value & transform to uppercase
-				std::string prop_value = tmxProp.second;
-				std::transform(prop_value.begin(), prop_value.end(), prop_value.begin(), ::toupper);
-
-				switch (cstr2int(prop_value.c_str()))
-				{
-				case cstr2int("NORMAL"):
-					prop.second = EntityPropertyValue(EPV_STRING, "NORMAL", NULL);
-					break;
-				case cstr2int("SOLID"):
-					prop.second = EntityPropertyValue(EPV_STRING, "SOLID", NULL);
-					break;
-				case cstr2int("TRIGGER"):
-					prop.second = EntityPropertyValue(EPV_STRING, "TRIGGER", NULL);
-					break;
-				case cstr2int("BUTTON"):
-					prop.second = EntityPropertyValue(EPV_STRING, "BUTTON", NULL);
-					break;
-				case cstr2int("GATE"):
-					prop.second = EntityPropertyValue(EPV_STRING, "GATE", NULL);
-					break;
-				case cstr2int("COMPUTER"):
-					prop.second = EntityPropertyValue(EPV_STRING, "COMPUTER", NULL);
-					break;
-				default:
-					LOG_ERROR("Entity: Unknown entity property value: %s! Parsing properties interrupted.", prop_value.c_str());
-					return props;
-				}
-			}
-
-			LOG_INFO("Entity: Parsed entity property name: %10s, value type: %1d, value str: %10s, value num: %4d", prop_name.c_str(), prop.second.type, prop.second.value_str.c_str(), prop.second.value_num);
-
-			// Push to entity properties vector
-			props.push_back(prop);
-		}
-
-		return props;
-	}
+	const EntityProperties & getProperties() const;
 protected:
+	void resolveAgainst(Entity & e, const vec2 & v, double dt);
+
 	Game * const m_game;
 	json m_json;
 	std::string m_name;
 	std::map<std::string, Sprite> m_spriteSheet;
 	std::string m_currentSprite;
-	std::vector<Tile *> m_currentTileCollisions;
+	uint32_t m_currentTileClasses;
+	// Entities whose swept AABB overlapped this one's in the last tick
 	std::vector<Entity *> m_currentEntityCollisions;
 	AABB m_initAABB;
 	AABB m_physAABB;
 	vec2 m_spawn;
+	vec2 m_prevPosition;
 	vec2 m_position;
 	vec2 m_velocity;
 	float m_airFriction;
@@ -2,6 +2,8 @@
 #include <fstream>
 #include <exception>
 #include <string>
+#include <chrono>
+#include <algorithm>
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <SDL_mixer.h>
@@ -11,13 +13,18 @@
 #include "resmanager.h"
 #include "gamestate.h"
 #include "playstate.h"
+#include "level.h"
+#include "gridtuner.h"
+#include "gridbench.h"
+#include "tmxmap.h"
 
-Game::Game(const std::string & cfgFilePath) :
+Game::Game(const std::string & cfgFilePath, const std::string & displayBackend) :
 	// Game state
 	m_config(),
 	m_runState(GRS_INITIALIZED),
 	m_gameStates(),
 	m_inputKeys(SDL_GetKeyboardState(NULL)),
+	m_inputKeyCount(0),
 
 	// Resources
 	m_resMan(new ResManager(this)),
@@ -32,12 +39,24 @@ Game::Game(const std::string & cfgFilePath) :
 	m_tickTime(1000.0 / 80.0),
 	m_deltaUpTime(m_tickTime),
 	m_physicsDistance(1),
+	m_simThreaded(false),
+	m_simThread(),
+	m_simRunning(false),
+	m_inputMutex(),
+	m_sharedInputKeys(),
+	m_simInputKeys(),
 
 	// Graphics
 	m_display(nullptr),
 	m_deltaReTime(m_frameTime),
 	m_frameTime(1000.0 / 128.0),
-	m_renderDistance(1)
+	m_renderDistance(1),
+	m_unfocusedFrameTime(1000.0 / 30.0),
+	m_windowMinimized(false),
+	m_windowFocused(true),
+	m_idleTime(0.0),
+	m_idleStart(0.0),
+	m_idlePercent(0.0)
 {
 	// Load config.json file
 	std::ifstream cfgFile("./data/config.json", std::ifstream::binary);
@@ -55,13 +74,15 @@ Game::Game(const std::string & cfgFilePath) :
 	// Get game JSON object
 	json & json_game = m_config["game"];
 
-	// Parse window configuration, create display
+	// Parse window configuration, create display. The backend given on the
+	// command line overrides the configured one.
 	json & json_window = json_game["window"];
 	m_display = new Display(
 		json_window["title"].get<std::string>(),
 		json_window["width"].get<int32_t>(),
 		json_window["height"].get<int32_t>(),
-		json_window["scale"].get<int32_t>()
+		json_window["scale"].get<int32_t>(),
+		Display::strToBackend(displayBackend.empty() ? json_window["backend"].get<std::string>() : displayBackend)
 	);
 
 	// Set to fullscreen if config says so
@@ -74,10 +95,17 @@ Game::Game(const std::string & cfgFilePath) :
 	m_tickTime = 1000.0 / json_phys["tickRate"].get<double>();
 	m_deltaUpTime = m_tickTime;
 	m_physicsDistance = json_phys["physicsDistance"].get<int32_t>();
+	m_simThreaded = json_phys["simulationThread"].get<bool>();
+
+	// Keyboard state copies handed to the simulation thread
+	SDL_GetKeyboardState(&m_inputKeyCount);
+	m_sharedInputKeys.assign(m_inputKeys, m_inputKeys + m_inputKeyCount);
+	m_simInputKeys = m_sharedInputKeys;
 
 	// Configure graphics
 	json & json_graph = json_game["graphics"];
 	m_frameTime = 1000.0 / json_graph["frameRate"].get<double>();
+	m_unfocusedFrameTime = 1000.0 / json_graph["unfocusedFrameRate"].get<double>();
 	m_deltaReTime = m_frameTime;
 	m_renderDistance = json_graph["renderDistance"].get<int32_t>();
 
@@ -106,6 +134,11 @@ Game::Game(const std::string & cfgFilePath) :
 		m_gameLevels.push_back(m_resMan->loadLevel("./data/levels/" + json_levels[i].get<std::string>() + ".tmx", json_levels[i].get<std::string>()));
 	}
 
+	// Pack the textures of the loaded levels & their entities into atlas pages
+	const int32_t atlasSize = json_graph["textureAtlasSize"].get<int32_t>();
+	if (atlasSize > 0)
+		m_resMan->packTextures(atlasSize);
+
 	// Pust the initial gamestate into stack
 	m_gameStates.push(new PlayState(this, m_gameLevels[0]));
 
@@ -137,32 +170,30 @@ GameRunState Game::run()
 	SDL_Event event;
 
 	// Physics/Timing related stuff
-	m_ticks = m_startTime = getTicksInMs();
+	m_ticks = m_startTime = m_idleStart = getTicksInMs();
 	double lastUpdate = m_ticks, lastRender = m_ticks;
 	double accumulator = 0.0;
 
 	LOG("Game: Game::run() called, starting game main loop.");
 
+	// Simulation runs on its own thread, this one renders & pumps events
+	if (m_simThreaded)
+	{
+		m_simRunning = true;
+		m_simThread = std::thread(&Game::simulate, this);
+		LOG("Game: Simulation thread started.");
+	}
+
 	m_runState = GRS_RUNNING_DBG;
 	while (m_runState == GRS_RUNNING || m_runState == GRS_RUNNING_DBG)
 	{
 		m_ticks = getTicksInMs();
 
-		if (m_ticks >= lastUpdate + m_tickTime)
-		{
-			m_deltaUpTime = m_ticks - lastUpdate;
-			accumulator += m_deltaUpTime;
-
-			while (accumulator >= m_timeStep)
-			{
-				update();
-				accumulator -= m_tickTime;
-			}
-
-			lastUpdate = m_ticks;
-		}
+		if (!m_simThreaded)
+			tick(lastUpdate, accumulator);
 
-		if (m_ticks >= lastRender + m_frameTime)
+		const double frameTime = (m_windowFocused) ? m_frameTime : m_unfocusedFrameTime;
+		if (!m_windowMinimized && m_ticks >= lastRender + frameTime)
 		{
 			m_deltaReTime = m_ticks - lastRender;
 			render();
@@ -176,6 +207,32 @@ GameRunState Game::run()
 			case SDL_QUIT:
 				m_runState = GRS_STOPPED;
 				break;
+			case SDL_WINDOWEVENT:
+				switch (event.window.event)
+				{
+				case SDL_WINDOWEVENT_MINIMIZED:
+					m_windowMinimized = true;
+					break;
+				case SDL_WINDOWEVENT_RESTORED:
+				case SDL_WINDOWEVENT_MAXIMIZED:
+					m_windowMinimized = false;
+					break;
+				case SDL_WINDOWEVENT_FOCUS_GAINED:
+					m_windowFocused = true;
+					break;
+				case SDL_WINDOWEVENT_FOCUS_LOST:
+					m_windowFocused = false;
+					break;
+				}
+				break;
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				// Baked tile chunks were lost with the render targets
+				for (Level * l : m_gameLevels)
+				{
+					l->invalidateTiles(l->getAABB());
+				}
+				break;
 			}
 
 			if (m_inputKeys[SDL_SCANCODE_ESCAPE])
@@ -184,12 +241,157 @@ GameRunState Game::run()
 			}
 		}
 
-		// SDL_Delay(1);
+		if (m_simThreaded)
+			publishInput();
+
+		// Next deadline, a minimized window only wakes up for ticks & events
+		double deadline = (m_windowMinimized) ? m_ticks + 100.0 : lastRender + frameTime;
+		if (!m_simThreaded)
+			deadline = std::min(deadline, lastUpdate + m_tickTime);
+
+		pace(deadline);
+	}
+
+	if (m_simThreaded)
+	{
+		m_simRunning = false;
+		m_simThread.join();
+		LOG("Game: Simulation thread stopped.");
 	}
 
 	return m_runState;
 }
 
+// Runs as many fixed steps as the time passed since the last update calls for
+void Game::tick(double & lastUpdate, double & accumulator)
+{
+	const double ticks = getTicksInMs();
+
+	if (ticks >= lastUpdate + m_tickTime)
+	{
+		m_deltaUpTime = ticks - lastUpdate;
+		accumulator += m_deltaUpTime;
+
+		while (accumulator >= m_timeStep)
+		{
+			update();
+			accumulator -= m_tickTime;
+		}
+
+		lastUpdate = ticks;
+	}
+}
+
+// Waits for the deadline or the next event. Most of the wait is slept in
+// SDL_WaitEventTimeout, its millisecond timeout is too coarse for the last
+// stretch which is spun instead. Time slept counts as idle.
+void Game::pace(double deadline)
+{
+	const double start = getTicksInMs();
+	const double wait = deadline - start;
+	bool woken = false;
+
+	if (wait > 2.0)
+	{
+		woken = SDL_WaitEventTimeout(NULL, static_cast<int>(wait - 1.0)) == 1;
+		m_idleTime += getTicksInMs() - start;
+	}
+
+	while (!woken && getTicksInMs() < deadline)
+	{
+		std::this_thread::yield();
+	}
+
+	// Idle share of the main thread over the last second or so
+	const double now = getTicksInMs();
+	if (now >= m_idleStart + 1000.0)
+	{
+		m_idlePercent = 100.0 * m_idleTime / (now - m_idleStart);
+		m_idleTime = 0.0;
+		m_idleStart = now;
+	}
+}
+
+// Simulation thread main loop, sleeps between ticks
+void Game::simulate()
+{
+	double lastUpdate = getTicksInMs();
+	double accumulator = 0.0;
+
+	while (m_simRunning)
+	{
+		consumeInput();
+		tick(lastUpdate, accumulator);
+
+		// Sleep through most of the wait, timer resolution may be a millisecond or worse
+		const double wait = lastUpdate + m_tickTime - getTicksInMs();
+		if (wait > 2.0)
+			std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>((wait - 1.0) * 1000.0)));
+		else
+			std::this_thread::yield();
+	}
+}
+
+void Game::publishInput()
+{
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+	std::copy(m_inputKeys, m_inputKeys + m_inputKeyCount, m_sharedInputKeys.begin());
+}
+
+void Game::consumeInput()
+{
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+	m_simInputKeys = m_sharedInputKeys;
+}
+
+GameRunState Game::tuneGrids(bool writeBack)
+{
+	if (m_runState != GRS_INITIALIZED)
+	{
+		ERR("Game: Game::tuneGrids() called before game was initialized properly.");
+		return m_runState;
+	}
+
+	LOG("Game: Game::tuneGrids() called, tuning grid cell sizes of " << m_gameLevels.size() << " levels.");
+
+	for (Level * l : m_gameLevels)
+	{
+		GridTuner tuner(l);
+		tuner.tune({ 4, 8, 16, 32, 64, 128, 256 }, 200000);
+		tuner.report();
+
+		if (writeBack)
+			tuner.writeBack();
+	}
+
+	m_runState = GRS_STOPPED;
+
+	return m_runState;
+}
+
+GameRunState Game::benchGrids()
+{
+	if (m_runState != GRS_INITIALIZED)
+	{
+		ERR("Game: Game::benchGrids() called before game was initialized properly.");
+		return m_runState;
+	}
+
+	LOG("Game: Game::benchGrids() called, benchmarking grid backends on " << m_gameLevels.size() << " levels.");
+
+	for (Level * l : m_gameLevels)
+	{
+		// One tile per cell, render distance in tiles like the level tile grid had
+		GridBench bench(l);
+		bench.run(static_cast<int32_t>(l->getTmxMap()->getMapData().tilewidth), getRenderDistance(), 20, 2000, 200000);
+		bench.report();
+	}
+
+	m_runState = GRS_STOPPED;
+
+	return m_runState;
+}
+
 void Game::update()
 {
 	if (!m_gameStates.empty())
@@ -231,9 +433,10 @@ GameRunState Game::getRunState() const
 	return m_runState;
 }
 
+// The simulation thread reads its own copy of the keyboard state
 const uint8_t * const Game::getInputKeys() const
 {
-	return m_inputKeys;
+	return (m_simThreaded) ? m_simInputKeys.data() : m_inputKeys;
 }
 
 // Resources
@@ -258,6 +461,11 @@ std::vector<Level *> Game::getGameLevels() const
 }
 
 // Physics
+bool Game::getSimThreaded() const
+{
+	return m_simThreaded;
+}
+
 double Game::getCurrentTimeInMs() const
 {
 	return getTicksInMs() - m_startTime;
@@ -268,9 +476,15 @@ double Game::getDeltaUpTime() const
 	return m_deltaUpTime;
 }
 
+// Sub-millisecond precision, interpolated rendering depends on it
 double Game::getTicksInMs() const
 {
-	return static_cast<double>((SDL_GetPerformanceCounter() * 1000) / SDL_GetPerformanceFrequency());
+	return static_cast<double>(SDL_GetPerformanceCounter()) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+double Game::getTickTimeInMs() const
+{
+	return m_tickTime;
 }
 
 int32_t Game::getPhysicsDistance() const
@@ -289,6 +503,11 @@ double Game::getDeltaReTime() const
 	return m_deltaReTime;
 }
 
+double Game::getIdlePercent() const
+{
+	return m_idlePercent;
+}
+
 int32_t Game::getRenderDistance() const
 {
 	return m_renderDistance;
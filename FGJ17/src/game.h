@@ -3,6 +3,10 @@
 
 #include <cstdint>
 #include <stack>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include "3rdparty/json.hpp"
 
 using json = nlohmann::json;
@@ -26,11 +30,14 @@ enum GameRunState
 class Game
 {
 public:
-	Game(const std::string & cfgFilePath = "./data/config.json");
+	Game(const std::string & cfgFilePath = "./data/config.json", const std::string & displayBackend = "");
 	~Game();
 	GameRunState run();
+	GameRunState tuneGrids(bool writeBack);
+	GameRunState benchGrids();
 	void update();
 	void render();
+	void tick(double & lastUpdate, double & accumulator);
 	void setMusicSong(Mix_Music * music, int32_t loops = -1);
 	void setMusicVolume(int32_t volume);
 
@@ -46,21 +53,30 @@ public:
 	std::vector<Level *> getGameLevels() const;
 
 	// Physics
+	bool getSimThreaded() const;
 	double getCurrentTimeInMs() const;
 	double getDeltaUpTime() const;
 	double getTicksInMs() const;
+	double getTickTimeInMs() const;
 	int32_t getPhysicsDistance() const;
 
 	// Graphics
 	Display * const getDisplay() const;
 	double getDeltaReTime() const;
+	double getIdlePercent() const;
 	int32_t getRenderDistance() const;
 private:
+	void pace(double deadline);
+	void simulate();
+	void publishInput();
+	void consumeInput();
+
 	// Game state
 	json m_config;
 	GameRunState m_runState;
 	std::stack<GameState *> m_gameStates;
 	const uint8_t * const m_inputKeys;
+	int32_t m_inputKeyCount;
 
 	// Resources
 	ResManager * m_resMan;
@@ -73,14 +89,30 @@ private:
 	double m_timeStep;
 	double m_ticks;
 	double m_tickTime;
-	double m_deltaUpTime;
+	std::atomic<double> m_deltaUpTime;
 	int32_t m_physicsDistance;
 
+	// Simulation thread, owns Game::update() while running
+	bool m_simThreaded;
+	std::thread m_simThread;
+	std::atomic<bool> m_simRunning;
+	std::mutex m_inputMutex;
+	std::vector<uint8_t> m_sharedInputKeys;
+	std::vector<uint8_t> m_simInputKeys;
+
 	// Graphics
 	Display * m_display;
 	double m_frameTime;
 	double m_deltaReTime;
 	int32_t m_renderDistance;
+
+	// Frame pacing, unfocused windows render slower & minimized ones not at all
+	double m_unfocusedFrameTime;
+	bool m_windowMinimized;
+	bool m_windowFocused;
+	double m_idleTime;
+	double m_idleStart;
+	double m_idlePercent;
 };
 
 #endif // GAME_H
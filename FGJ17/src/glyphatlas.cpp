@@ -0,0 +1,116 @@
+#include "glyphatlas.h"
+#include <SDL_ttf.h>
+#include <algorithm>
+#include "macros.h"
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer * const renderer, TTF_Font * const font) :
+	m_renderer(renderer),
+	m_font(font),
+	m_texture(NULL),
+	m_glyphs(),
+	m_height(0),
+	m_built(false)
+{
+
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	if (m_texture != NULL)
+		SDL_DestroyTexture(m_texture);
+}
+
+SDL_Texture * const GlyphAtlas::getTexture()
+{
+	if (!m_built)
+		build();
+
+	return m_texture;
+}
+
+const GlyphInfo * const GlyphAtlas::getGlyph(char c)
+{
+	if (!m_built)
+		build();
+
+	// Characters outside the atlas are drawn as '?'
+	if (c < GLYPH_FIRST || c > GLYPH_LAST)
+		c = '?';
+
+	return &m_glyphs[c - GLYPH_FIRST];
+}
+
+int32_t GlyphAtlas::getHeight()
+{
+	if (!m_built)
+		build();
+
+	return m_height;
+}
+
+void GlyphAtlas::build()
+{
+	const SDL_Color white = { 255, 255, 255, 255 };
+	const int32_t n_glyphs = GLYPH_LAST - GLYPH_FIRST + 1;
+	SDL_Surface * surfaces[n_glyphs];
+
+	m_built = true;
+	m_height = TTF_FontHeight(m_font);
+
+	// Rasterize the glyphs & lay them out in rows, 1px apart
+	int32_t x = 0, y = 0, w = 0;
+	for (int32_t i = 0; i < n_glyphs; i++)
+	{
+		const uint16_t c = static_cast<uint16_t>(GLYPH_FIRST + i);
+		int32_t advance = 0;
+
+		surfaces[i] = TTF_RenderGlyph_Blended(m_font, c, white);
+		TTF_GlyphMetrics(m_font, c, NULL, NULL, NULL, NULL, &advance);
+
+		const int32_t gw = (surfaces[i] != NULL) ? surfaces[i]->w : 0;
+		const int32_t gh = (surfaces[i] != NULL) ? surfaces[i]->h : 0;
+
+		if (x + gw > ATLAS_MAX_WIDTH)
+		{
+			x = 0;
+			y += m_height + 1;
+		}
+
+		m_glyphs[i] = GlyphInfo{ SDL_Rect{ x, y, gw, gh }, advance };
+		x += gw + 1;
+		w = std::max(w, x);
+	}
+
+	SDL_Surface * atlas = SDL_CreateRGBSurfaceWithFormat(0, std::max(w, 1), y + m_height, 32, SDL_PIXELFORMAT_RGBA32);
+
+	for (int32_t i = 0; i < n_glyphs; i++)
+	{
+		if (surfaces[i] == NULL)
+			continue;
+
+		if (atlas == NULL)
+		{
+			SDL_FreeSurface(surfaces[i]);
+			continue;
+		}
+
+		// Copy coverage as is instead of blending it onto the empty atlas
+		SDL_Rect destRect = m_glyphs[i].srcRect;
+		SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(surfaces[i], NULL, atlas, &destRect);
+		SDL_FreeSurface(surfaces[i]);
+	}
+
+	m_texture = (atlas != NULL) ? SDL_CreateTextureFromSurface(m_renderer, atlas) : NULL;
+	SDL_FreeSurface(atlas);
+
+	if (m_texture == NULL)
+	{
+		ERR("GlyphAtlas: SDL_CreateTextureFromSurface Error: " << SDL_GetError());
+		return;
+	}
+
+	SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+
+	LOG("GlyphAtlas: Built glyph atlas (" << std::max(w, 1) << "x" << y + m_height << ").");
+}
@@ -0,0 +1,41 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <SDL.h>
+#include <cstdint>
+
+typedef struct _TTF_Font TTF_Font;
+
+struct GlyphInfo
+{
+	SDL_Rect srcRect;
+	int32_t advance;
+};
+
+// Printable ASCII glyphs of one font rasterized once, white, into a single
+// texture. Text is drawn as one quad per glyph, tinted by vertex colour.
+// The atlas is built on first use.
+class GlyphAtlas
+{
+public:
+	GlyphAtlas(SDL_Renderer * const renderer, TTF_Font * const font);
+	~GlyphAtlas();
+	SDL_Texture * const getTexture();
+	const GlyphInfo * const getGlyph(char c);
+	int32_t getHeight();
+private:
+	void build();
+
+	static const char GLYPH_FIRST = ' ';
+	static const char GLYPH_LAST = '~';
+	static const int32_t ATLAS_MAX_WIDTH = 1024;
+
+	SDL_Renderer * const m_renderer;
+	TTF_Font * const m_font;
+	SDL_Texture * m_texture;
+	GlyphInfo m_glyphs[GLYPH_LAST - GLYPH_FIRST + 1];
+	int32_t m_height;
+	bool m_built;
+};
+
+#endif // GLYPHATLAS_H
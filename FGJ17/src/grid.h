@@ -3,80 +3,242 @@
 
 #include <cstdint>
 #include <cassert>
-#include <map>
+#include <algorithm>
+#include <string>
 #include <vector>
+#include "tools.h"
 #include "vec2.h"
+#include "aabb.h"
 #include "macros.h"
 
+enum GridStorage : uint8_t
+{
+	GS_DENSE = 0,
+	GS_HASH = 1
+};
+
+// Stable reference to an item inserted into a Grid
+typedef uint32_t GridHandle;
+
+const GridHandle GRID_HANDLE_NULL = 0xFFFFFFFF;
+
+// Cell occupancy of a Grid and its query counters since resetStats().
+// Items spanning several cells are counted once per cell.
+struct GridStats
+{
+	uint32_t cells;
+	uint32_t cellsUsed;
+	uint32_t items;
+	uint32_t minItems;
+	uint32_t maxItems;
+	float avgItems;
+	uint64_t queries;
+	uint64_t candidates;
+};
+
+inline GridStorage strToGridStorage(const std::string & str)
+{
+	// Transform str to uppercase
+	std::string strUpper = str;
+	std::transform(strUpper.begin(), strUpper.end(), strUpper.begin(), ::toupper);
+
+	switch (cstr2int(strUpper.c_str()))
+	{
+	case cstr2int("DENSE"):
+		return GS_DENSE;
+	case cstr2int("HASH"):
+	default:
+		return GS_HASH;
+	}
+}
+
+// Uniform spatial grid. Cells live in one flat table, addressed either
+// directly (GS_DENSE, bounded extents) or via an open-addressing hash of
+// the cell coordinate (GS_HASH, unbounded extents). Items are inserted
+// either at a point or over every cell an AABB spans.
 template<typename T>
 class Grid
 {
-	typedef std::pair<int32_t, int32_t> GridKey;
-	typedef std::pair<vec2, T> GridValue;
+	struct GridValue
+	{
+		vec2 pos;
+		T data;
+		GridHandle handle;
+	};
+
+	// Cell span of an item, cell & index are only valid for single cell spans
+	struct GridLocation
+	{
+		int32_t x0;
+		int32_t y0;
+		int32_t x1;
+		int32_t y1;
+		uint32_t cell;
+		uint32_t index;
+
+		bool single() const
+		{
+			return x0 == x1 && y0 == y1;
+		}
+	};
+
+	typedef std::vector<GridValue> GridCell;
+
+	struct GridSlot
+	{
+		uint64_t key;
+		uint32_t cell;
+	};
+
+	static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
 
 public:
+	// Unbounded grid, cells are hashed
 	Grid(const int32_t cellDivisor = 32) :
 		m_cellDivisor(cellDivisor),
-		m_data()
+		m_storage(GS_HASH),
+		m_minX(0),
+		m_minY(0),
+		m_cellsW(0),
+		m_cellsH(0),
+		m_cells(),
+		m_slots(16, GridSlot{ 0, EMPTY_SLOT }),
+		m_locations(),
+		m_freeHandles(),
+		m_queries(0),
+		m_candidates(0)
 	{
 
 	}
 
+	// Bounded grid, cells covering the given extents are allocated up front.
+	// Positions outside of the extents are clamped to the border cells.
+	Grid(const int32_t cellDivisor, const AABB & bounds, GridStorage storage = GS_DENSE) :
+		m_cellDivisor(cellDivisor),
+		m_storage(storage),
+		m_minX(0),
+		m_minY(0),
+		m_cellsW(0),
+		m_cellsH(0),
+		m_cells(),
+		m_slots(),
+		m_locations(),
+		m_freeHandles(),
+		m_queries(0),
+		m_candidates(0)
+	{
+		if (m_storage == GS_DENSE)
+		{
+			m_minX = cellCoord(bounds.getMinP().x);
+			m_minY = cellCoord(bounds.getMinP().y);
+			m_cellsW = cellCoord(bounds.getMaxP().x) - m_minX + 1;
+			m_cellsH = cellCoord(bounds.getMaxP().y) - m_minY + 1;
+			m_cells.resize(static_cast<size_t>(m_cellsW) * static_cast<size_t>(m_cellsH));
+		}
+		else
+		{
+			m_slots.assign(16, GridSlot{ 0, EMPTY_SLOT });
+		}
+	}
+
 	~Grid()
 	{
 
 	}
 
-	void insertData(const vec2 & pos, T data)
+	GridHandle insertData(const vec2 & pos, T data)
 	{
 		const vec2 valPos = pos.floor();
-		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
-		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
-		const GridKey idx(ix, iy);
-		const GridValue val(valPos, data);
+		const int32_t ix = cellCoord(valPos.x);
+		const int32_t iy = cellCoord(valPos.y);
+		const GridHandle handle = allocHandle();
+
+		insertSpan(handle, makeLocation(ix, iy, ix, iy), GridValue{ valPos, data, handle });
 
-		m_data[idx].push_back(val);
+		return handle;
+	}
+
+	// Inserts the item into every cell the AABB spans
+	GridHandle insertData(const AABB & aabb, T data)
+	{
+		const GridHandle handle = allocHandle();
+
+		insertSpan(handle, makeLocation(aabb), GridValue{ aabb.getCenterP().floor(), data, handle });
+
+		return handle;
+	}
+
+	// Updates the position of an inserted item, the item is relocated only
+	// when it crosses into another cell
+	void moveData(const GridHandle handle, const vec2 & pos)
+	{
+		const vec2 valPos = pos.floor();
+		const int32_t ix = cellCoord(valPos.x);
+		const int32_t iy = cellCoord(valPos.y);
+
+		moveSpan(handle, makeLocation(ix, iy, ix, iy), valPos);
+	}
+
+	// Updates the AABB of an inserted item, the item is relocated only when
+	// the span of cells it covers changes
+	void moveData(const GridHandle handle, const AABB & aabb)
+	{
+		moveSpan(handle, makeLocation(aabb), aabb.getCenterP().floor());
+	}
+
+	void removeData(const GridHandle handle)
+	{
+		assert(handle < m_locations.size());
+
+		eraseSpan(handle);
+		m_freeHandles.push_back(handle);
 	}
 
 	void deleteData(const vec2 & pos)
 	{
 		const vec2 valPos = pos.floor();
-		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
-		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
-		const GridKey idx(ix, iy);
+		GridCell * cell = findCell(cellCoord(valPos.x), cellCoord(valPos.y), true);
 
-		if (m_data.find(idx) != m_data.end())
+		if (cell != nullptr)
 		{
-			for (size_t i = 0; i < m_data[idx].size(); i++)
+			for (size_t i = 0; i < cell->size(); )
 			{
-				if (m_data[idx][i].first == valPos)
-					m_data[idx].erase(m_data[idx].begin() + i);
+				if ((*cell)[i].pos == valPos)
+					removeData((*cell)[i].handle);
+				else
+					i++;
 			}
 		}
 	}
 
+	// Empties every cell, the cell table itself and cell capacities are kept.
+	// All handles are invalidated.
 	void clearData()
 	{
-		m_data.clear();
+		for (GridCell & cell : m_cells)
+		{
+			cell.clear();
+		}
+
+		m_locations.clear();
+		m_freeHandles.clear();
 	}
 
 	bool getData(const vec2 & pos, std::vector<T> & data)
 	{
 		const vec2 valPos = pos.floor();
-		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
-		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
-		const GridKey idx(ix, iy);
+		const GridCell * cell = findCell(cellCoord(valPos.x), cellCoord(valPos.y), true);
 		bool data_found = false;
 
-		if (m_data.find(idx) != m_data.end())
+		if (cell != nullptr)
 		{
-			for (size_t i = 0; i < m_data[idx].size(); i++)
+			for (const GridValue & val : *cell)
 			{
-				if (m_data[idx][i].first == valPos)
+				if (val.pos == valPos)
 				{
 					data_found = true;
 
-					data.push_back(m_data[idx][i].second);
+					data.push_back(val.data);
 				}
 			}
 		}
@@ -85,59 +247,378 @@ public:
 	}
 
 	bool getNearestData(const vec2 & pos, const int32_t range, std::vector<T> & data)
+	{
+		size_t n_data = 0;
+
+		visitNearestData(pos, range, [&](T val)
+		{
+			if (n_data++ == 0)
+				data.clear();
+
+			data.push_back(val);
+		});
+
+		return n_data > 0;
+	}
+
+	// Calls visitor(T) once for every item in the cells within range of pos,
+	// in place. Nothing is copied or allocated.
+	template<typename F>
+	void visitNearestData(const vec2 & pos, const int32_t range, F && visitor)
 	{
 		const vec2 valPos = pos.floor();
-		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
-		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
-		bool data_found = false;
-		std::vector<GridValue> nearestData;
+		const int32_t ix = cellCoord(valPos.x);
+		const int32_t iy = cellCoord(valPos.y);
+		const int32_t r = (range <= 0) ? 0 : range;
+
+		visitSpan(ix - r, iy - r, ix + r, iy + r, visitor);
+	}
+
+	// Calls visitor(T) once for every item whose cells overlap the cells
+	// spanned by the AABB. Nothing is copied or allocated. Items are stored
+	// half-open, so the query reaches one cell back from a min edge lying on
+	// a cell boundary to still find items merely touching it.
+	template<typename F>
+	void visitOverlappingData(const AABB & aabb, F && visitor)
+	{
+		visitSpan(
+			cellCoordEnd(aabb.getMinP().x),
+			cellCoordEnd(aabb.getMinP().y),
+			cellCoord(aabb.getMaxP().x),
+			cellCoord(aabb.getMaxP().y),
+			visitor
+		);
+	}
+
+	// Occupancy is gathered over the used cells only
+	GridStats getStats() const
+	{
+		GridStats stats = GridStats{ static_cast<uint32_t>(m_cells.size()), 0, 0, 0, 0, 0.0f, m_queries, m_candidates };
+
+		for (const GridCell & cell : m_cells)
+		{
+			const uint32_t n = static_cast<uint32_t>(cell.size());
+
+			if (n == 0)
+				continue;
+
+			stats.minItems = (stats.cellsUsed == 0) ? n : std::min(stats.minItems, n);
+			stats.maxItems = std::max(stats.maxItems, n);
+			stats.items += n;
+			stats.cellsUsed++;
+		}
+
+		if (stats.cellsUsed > 0)
+			stats.avgItems = static_cast<float>(stats.items) / stats.cellsUsed;
+
+		return stats;
+	}
 
-		if (range <= 0)
+	void resetStats()
+	{
+		m_queries = 0;
+		m_candidates = 0;
+	}
+
+	int32_t getCellDivisor() const
+	{
+		return m_cellDivisor;
+	}
+
+	GridStorage getStorage() const
+	{
+		return m_storage;
+	}
+
+private:
+	int32_t cellCoord(const float v) const
+	{
+		return static_cast<int32_t>(std::floor(v / m_cellDivisor));
+	}
+
+	// Last cell ending at or after v, the max edge of a half-open span. A v
+	// exactly on a cell boundary belongs to the cell before it.
+	int32_t cellCoordEnd(const float v) const
+	{
+		return static_cast<int32_t>(std::ceil(v / m_cellDivisor)) - 1;
+	}
+
+	GridLocation makeLocation(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const
+	{
+		if (m_storage == GS_DENSE)
 		{
-			const GridKey idx(ix, iy);
+			x0 = std::min(std::max(x0, m_minX), m_minX + m_cellsW - 1);
+			y0 = std::min(std::max(y0, m_minY), m_minY + m_cellsH - 1);
+			x1 = std::min(std::max(x1, m_minX), m_minX + m_cellsW - 1);
+			y1 = std::min(std::max(y1, m_minY), m_minY + m_cellsH - 1);
+		}
+
+		return GridLocation{ x0, y0, x1, y1, 0, 0 };
+	}
+
+	// Boxes cover [min, max) in cells, a cell aligned box fills exactly its
+	// cells. Degenerate boxes still take the one cell of their min corner.
+	GridLocation makeLocation(const AABB & aabb) const
+	{
+		const int32_t x0 = cellCoord(aabb.getMinP().x);
+		const int32_t y0 = cellCoord(aabb.getMinP().y);
 
-			if (m_data.find(idx) != m_data.end())
+		return makeLocation(
+			x0,
+			y0,
+			std::max(cellCoordEnd(aabb.getMaxP().x), x0),
+			std::max(cellCoordEnd(aabb.getMaxP().y), y0)
+		);
+	}
+
+	template<typename F>
+	void visitSpan(const int32_t x0, const int32_t y0, const int32_t x1, const int32_t y1, F & visitor)
+	{
+		m_queries++;
+
+		for (int32_t y = y0; y <= y1; y++)
+		{
+			for (int32_t x = x0; x <= x1; x++)
 			{
-				data_found = true;
+				const GridCell * cell = findCell(x, y);
 
-				nearestData = m_data[idx];
+				if (cell == nullptr)
+					continue;
+
+				for (const GridValue & val : *cell)
+				{
+					const GridLocation & loc = m_locations[val.handle];
+
+					// Items spanning several cells are reported only from the
+					// first cell where their span and the query span overlap
+					if (!loc.single() && (x != std::max(loc.x0, x0) || y != std::max(loc.y0, y0)))
+						continue;
+
+					m_candidates++;
+					visitor(val.data);
+				}
 			}
 		}
-		else
+	}
+
+	uint32_t cellIndex(const GridCell & cell) const
+	{
+		return static_cast<uint32_t>(&cell - m_cells.data());
+	}
+
+	GridHandle allocHandle()
+	{
+		if (m_freeHandles.empty())
+		{
+			m_locations.push_back(GridLocation{ 0, 0, 0, 0, 0, 0 });
+			return static_cast<GridHandle>(m_locations.size() - 1);
+		}
+
+		const GridHandle handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+
+		return handle;
+	}
+
+	void insertSpan(const GridHandle handle, GridLocation loc, const GridValue & val)
+	{
+		for (int32_t y = loc.y0; y <= loc.y1; y++)
 		{
-			for (int32_t y = -range; y <= range; y++)
+			for (int32_t x = loc.x0; x <= loc.x1; x++)
 			{
-				for (int32_t x = -range; x <= range; x++)
-				{
-					const int32_t iix = ix + x;
-					const int32_t iiy = iy + y;
-					const GridKey idx(iix, iiy);
+				const uint32_t cell = cellIndex(touchCell(x, y));
 
-					if (m_data.find(idx) != m_data.end())
-					{
-						data_found = true;
+				loc.cell = cell;
+				loc.index = static_cast<uint32_t>(m_cells[cell].size());
+				m_cells[cell].push_back(val);
+			}
+		}
 
-						nearestData.insert(nearestData.end(), m_data[idx].begin(), m_data[idx].end());
+		m_locations[handle] = loc;
+	}
+
+	void eraseSpan(const GridHandle handle)
+	{
+		const GridLocation loc = m_locations[handle];
+
+		if (loc.single())
+		{
+			eraseAt(loc.cell, loc.index);
+			return;
+		}
+
+		for (int32_t y = loc.y0; y <= loc.y1; y++)
+		{
+			for (int32_t x = loc.x0; x <= loc.x1; x++)
+			{
+				const uint32_t cell = cellIndex(*findCell(x, y));
+
+				for (size_t i = 0; i < m_cells[cell].size(); i++)
+				{
+					if (m_cells[cell][i].handle == handle)
+					{
+						eraseAt(cell, static_cast<uint32_t>(i));
+						break;
 					}
 				}
 			}
 		}
+	}
+
+	void moveSpan(const GridHandle handle, const GridLocation & dst, const vec2 & valPos)
+	{
+		assert(handle < m_locations.size());
+
+		const GridLocation & loc = m_locations[handle];
+
+		if (loc.x0 == dst.x0 && loc.y0 == dst.y0 && loc.x1 == dst.x1 && loc.y1 == dst.y1)
+		{
+			if (loc.single())
+				m_cells[loc.cell][loc.index].pos = valPos;
+
+			return;
+		}
+
+		GridValue val = (loc.single()) ? m_cells[loc.cell][loc.index] : GridValue{ valPos, valueOf(handle), handle };
+		val.pos = valPos;
+
+		eraseSpan(handle);
+		insertSpan(handle, dst, val);
+	}
+
+	T valueOf(const GridHandle handle)
+	{
+		const GridLocation & loc = m_locations[handle];
+		const GridCell & cell = *findCell(loc.x0, loc.y0);
+
+		for (const GridValue & val : cell)
+		{
+			if (val.handle == handle)
+				return val.data;
+		}
+
+		assert(false);
+		return T();
+	}
+
+	// Swap-and-pop removal, the moved item's location is patched
+	void eraseAt(const uint32_t cell, const uint32_t index)
+	{
+		GridCell & c = m_cells[cell];
 
-		if (data_found)
+		if (index + 1 != c.size())
 		{
-			data.resize(nearestData.size());
-			for (size_t i = 0; i < data.size(); i++)
+			c[index] = c.back();
+
+			GridLocation & moved = m_locations[c[index].handle];
+			if (moved.single())
+				moved.index = index;
+		}
+
+		c.pop_back();
+	}
+
+	static uint64_t cellKey(const int32_t ix, const int32_t iy)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy);
+	}
+
+	size_t slotIndex(const uint64_t key) const
+	{
+		// Fibonacci hashing, table size is always a power of two
+		return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_slots.size() - 1);
+	}
+
+	GridCell * findCell(int32_t ix, int32_t iy, const bool clamp = false)
+	{
+		if (m_storage == GS_DENSE)
+		{
+			ix -= m_minX;
+			iy -= m_minY;
+
+			if (clamp)
 			{
-				data[i] = nearestData[i].second;
+				ix = std::min(std::max(ix, 0), m_cellsW - 1);
+				iy = std::min(std::max(iy, 0), m_cellsH - 1);
 			}
+
+			if (ix < 0 || iy < 0 || ix >= m_cellsW || iy >= m_cellsH)
+				return nullptr;
+
+			return &m_cells[static_cast<size_t>(iy) * m_cellsW + ix];
 		}
 
-		return data_found;
+		const uint64_t key = cellKey(ix, iy);
+		for (size_t i = slotIndex(key); ; i = (i + 1) & (m_slots.size() - 1))
+		{
+			const GridSlot & slot = m_slots[i];
+
+			if (slot.cell == EMPTY_SLOT)
+				return nullptr;
+
+			if (slot.key == key)
+				return &m_cells[slot.cell];
+		}
+	}
+
+	GridCell & touchCell(int32_t ix, int32_t iy)
+	{
+		if (m_storage == GS_DENSE)
+			return *findCell(ix, iy, true);
+
+		const uint64_t key = cellKey(ix, iy);
+		size_t i = slotIndex(key);
+		for (; m_slots[i].cell != EMPTY_SLOT; i = (i + 1) & (m_slots.size() - 1))
+		{
+			if (m_slots[i].key == key)
+				return m_cells[m_slots[i].cell];
+		}
+
+		// Keep the load factor at or below one half
+		if ((m_cells.size() + 1) * 2 > m_slots.size())
+		{
+			rehash(m_slots.size() * 2);
+			return touchCell(ix, iy);
+		}
+
+		m_slots[i] = GridSlot{ key, static_cast<uint32_t>(m_cells.size()) };
+		m_cells.push_back(GridCell());
+
+		return m_cells.back();
+	}
+
+	void rehash(const size_t n_slots)
+	{
+		std::vector<GridSlot> slots(n_slots, GridSlot{ 0, EMPTY_SLOT });
+		m_slots.swap(slots);
+
+		for (const GridSlot & slot : slots)
+		{
+			if (slot.cell == EMPTY_SLOT)
+				continue;
+
+			size_t i = slotIndex(slot.key);
+			while (m_slots[i].cell != EMPTY_SLOT)
+			{
+				i = (i + 1) & (m_slots.size() - 1);
+			}
+
+			m_slots[i] = slot;
+		}
 	}
 
-private:
 	const int32_t m_cellDivisor;
-	std::map<GridKey, std::vector<GridValue>> m_data;
+	GridStorage m_storage;
+	int32_t m_minX;
+	int32_t m_minY;
+	int32_t m_cellsW;
+	int32_t m_cellsH;
+	std::vector<GridCell> m_cells;
+	std::vector<GridSlot> m_slots;
+	std::vector<GridLocation> m_locations;
+	std::vector<GridHandle> m_freeHandles;
+	uint64_t m_queries;
+	uint64_t m_candidates;
 };
 
 #endif // GRID_H
@@ -0,0 +1,227 @@
+#include "gridbench.h"
+#include <chrono>
+#include <cmath>
+#include <map>
+#include "macros.h"
+#include "grid.h"
+#include "level.h"
+#include "tmxmap.h"
+
+// Grid as it was before the flat cell table, cells keyed by coordinate in
+// a std::map. Only the parts the benchmark calls are kept.
+template<typename T>
+class MapGrid
+{
+	typedef std::pair<int32_t, int32_t> GridKey;
+	typedef std::pair<vec2, T> GridValue;
+
+public:
+	MapGrid(const int32_t cellDivisor = 32) :
+		m_cellDivisor(cellDivisor),
+		m_data()
+	{
+
+	}
+
+	void insertData(const vec2 & pos, T data)
+	{
+		const vec2 valPos = pos.floor();
+		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
+		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
+		const GridKey idx(ix, iy);
+		const GridValue val(valPos, data);
+
+		m_data[idx].push_back(val);
+	}
+
+	void clearData()
+	{
+		m_data.clear();
+	}
+
+	bool getNearestData(const vec2 & pos, const int32_t range, std::vector<T> & data)
+	{
+		const vec2 valPos = pos.floor();
+		const int32_t ix = static_cast<int32_t>(std::floor(valPos.x / m_cellDivisor));
+		const int32_t iy = static_cast<int32_t>(std::floor(valPos.y / m_cellDivisor));
+		bool data_found = false;
+		std::vector<GridValue> nearestData;
+
+		if (range <= 0)
+		{
+			const GridKey idx(ix, iy);
+
+			if (m_data.find(idx) != m_data.end())
+			{
+				data_found = true;
+
+				nearestData = m_data[idx];
+			}
+		}
+		else
+		{
+			for (int32_t y = -range; y <= range; y++)
+			{
+				for (int32_t x = -range; x <= range; x++)
+				{
+					const int32_t iix = ix + x;
+					const int32_t iiy = iy + y;
+					const GridKey idx(iix, iiy);
+
+					if (m_data.find(idx) != m_data.end())
+					{
+						data_found = true;
+
+						nearestData.insert(nearestData.end(), m_data[idx].begin(), m_data[idx].end());
+					}
+				}
+			}
+		}
+
+		if (data_found)
+		{
+			data.resize(nearestData.size());
+			for (size_t i = 0; i < data.size(); i++)
+			{
+				data[i] = nearestData[i].second;
+			}
+		}
+
+		return data_found;
+	}
+
+private:
+	const int32_t m_cellDivisor;
+	std::map<GridKey, std::vector<GridValue>> m_data;
+};
+
+static double elapsedMs(const std::chrono::high_resolution_clock::time_point & start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+GridBench::GridBench(Level * const level, uint32_t seed) :
+	m_level(level),
+	m_rng(seed),
+	m_cellDivisor(0),
+	m_renderDistance(0),
+	m_inserts(0),
+	m_tileCentres(),
+	m_renderQueries(),
+	m_pointQueries(),
+	m_results()
+{
+
+}
+
+template<typename G>
+GridBenchResult GridBench::runGrid(const char * backend, G & grid)
+{
+	GridBenchResult result = GridBenchResult{ backend, 0.0, 0.0, 0.0, 0, 0 };
+	std::vector<uint32_t> data;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t run = 0; run < m_inserts; run++)
+	{
+		grid.clearData();
+
+		for (uint32_t i = 0; i < m_tileCentres.size(); i++)
+		{
+			grid.insertData(m_tileCentres[i], i);
+		}
+	}
+	result.insertMs = elapsedMs(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (const vec2 & p : m_renderQueries)
+	{
+		if (grid.getNearestData(p, m_renderDistance, data))
+			result.renderItems += data.size();
+	}
+	result.renderMs = elapsedMs(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (const vec2 & p : m_pointQueries)
+	{
+		if (grid.getNearestData(p, 1, data))
+			result.pointItems += data.size();
+	}
+	result.pointMs = elapsedMs(start);
+
+	return result;
+}
+
+void GridBench::run(int32_t cellDivisor, int32_t renderDistance, uint32_t n_inserts, uint32_t n_renderQueries, uint32_t n_pointQueries)
+{
+	const AABB bounds = m_level->getAABB();
+	std::uniform_real_distribution<float> x(bounds.getMinP().x, bounds.getMaxP().x);
+	std::uniform_real_distribution<float> y(bounds.getMinP().y, bounds.getMaxP().y);
+
+	m_cellDivisor = cellDivisor;
+	m_renderDistance = renderDistance;
+	m_inserts = n_inserts;
+
+	// Every tile of every layer, like the level tile grid used to hold
+	m_tileCentres.clear();
+	for (TmxLayerData & layer : m_level->getTmxMap()->getMapData().layer)
+	{
+		layer.visitTiles([&](const Tile & t)
+		{
+			m_tileCentres.push_back(t.getAABB().getCenterP());
+		});
+	}
+
+	m_renderQueries.clear();
+	for (uint32_t i = 0; i < n_renderQueries; i++)
+	{
+		m_renderQueries.push_back(vec2(x(m_rng), y(m_rng)));
+	}
+
+	m_pointQueries.clear();
+	for (uint32_t i = 0; i < n_pointQueries; i++)
+	{
+		m_pointQueries.push_back(m_tileCentres.empty() ? vec2(x(m_rng), y(m_rng)) : m_tileCentres[m_rng() % m_tileCentres.size()]);
+	}
+
+	m_results.clear();
+
+	MapGrid<uint32_t> mapGrid(cellDivisor);
+	m_results.push_back(runGrid("MAP", mapGrid));
+
+	Grid<uint32_t> denseGrid(cellDivisor, bounds, GS_DENSE);
+	m_results.push_back(runGrid("DENSE", denseGrid));
+
+	Grid<uint32_t> hashGrid(cellDivisor, bounds, GS_HASH);
+	m_results.push_back(runGrid("HASH", hashGrid));
+}
+
+void GridBench::report() const
+{
+	LOG_INFO(
+		"GridBench: level %s, %u tiles, cellDivisor %d, inserts x%u, range %d queries x%u, range 1 queries x%u:",
+		m_level->getName().c_str(), static_cast<uint32_t>(m_tileCentres.size()), m_cellDivisor,
+		m_inserts, m_renderDistance, static_cast<uint32_t>(m_renderQueries.size()), static_cast<uint32_t>(m_pointQueries.size())
+	);
+
+	for (const GridBenchResult & r : m_results)
+	{
+		LOG_INFO(
+			"GridBench: %-5s | insert %9.3f ms | range %d %9.3f ms, %10llu items | range 1 %9.3f ms, %10llu items",
+			r.backend.c_str(), r.insertMs,
+			m_renderDistance, r.renderMs, static_cast<unsigned long long>(r.renderItems),
+			r.pointMs, static_cast<unsigned long long>(r.pointItems)
+		);
+	}
+
+	// Every backend has to see the same items
+	for (const GridBenchResult & r : m_results)
+	{
+		if (r.renderItems != m_results.front().renderItems || r.pointItems != m_results.front().pointItems)
+			LOG_ERROR("GridBench: %s found other items than %s!", r.backend.c_str(), m_results.front().backend.c_str());
+	}
+}
+
+const std::vector<GridBenchResult> & GridBench::getResults() const
+{
+	return m_results;
+}
@@ -0,0 +1,48 @@
+#ifndef GRIDBENCH_H
+#define GRIDBENCH_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "vec2.h"
+
+class Level;
+
+struct GridBenchResult
+{
+	std::string backend;
+	double insertMs;
+	double renderMs;
+	double pointMs;
+	uint64_t renderItems;
+	uint64_t pointItems;
+};
+
+// Times the Grid backends against the std::map backed Grid they replaced,
+// on a level's tile centres: bulk insertion, render distance queries
+// around the camera & range 1 queries. The map backed Grid is kept here
+// only as the comparison point.
+class GridBench
+{
+public:
+	GridBench(Level * const level, uint32_t seed = 17);
+	void run(int32_t cellDivisor, int32_t renderDistance, uint32_t n_inserts, uint32_t n_renderQueries, uint32_t n_pointQueries);
+	void report() const;
+	const std::vector<GridBenchResult> & getResults() const;
+private:
+	template<typename G>
+	GridBenchResult runGrid(const char * backend, G & grid);
+
+	Level * const m_level;
+	std::mt19937 m_rng;
+	int32_t m_cellDivisor;
+	int32_t m_renderDistance;
+	uint32_t m_inserts;
+	std::vector<vec2> m_tileCentres;
+	std::vector<vec2> m_renderQueries;
+	std::vector<vec2> m_pointQueries;
+	std::vector<GridBenchResult> m_results;
+};
+
+#endif // GRIDBENCH_H
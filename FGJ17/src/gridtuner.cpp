@@ -0,0 +1,221 @@
+#include "gridtuner.h"
+#include <chrono>
+#include <algorithm>
+#include "macros.h"
+#include "level.h"
+#include "entity.h"
+
+// Entities in the synthetic crowd
+static const uint32_t TUNER_CROWD_SIZE = 256;
+
+static bool overlaps(const AABB & a, const AABB & b)
+{
+	return a.collidesX(b) && a.collidesY(b);
+}
+
+GridTuner::GridTuner(Level * const level, uint32_t seed) :
+	m_level(level),
+	m_rng(seed),
+	m_entityStorage(strToGridStorage(level->getJson()["level"]["entityGrid"]["storage"].get<std::string>())),
+	m_entityLevels(level->getJson()["level"]["entityGrid"]["levels"].get<int32_t>()),
+	m_entityCrowd(),
+	m_entitySteps(),
+	m_entityTicks(0),
+	m_entityResults(),
+	m_entityHResults()
+{
+
+}
+
+void GridTuner::tune(const std::vector<int32_t> & cellDivisors, uint32_t n_queries, uint32_t n_runs)
+{
+	buildWorkload(n_queries);
+
+	m_entityResults.clear();
+	m_entityHResults.clear();
+
+	for (int32_t cellDivisor : cellDivisors)
+	{
+		m_entityResults.push_back(runEntities(cellDivisor, n_runs, false));
+		m_entityHResults.push_back(runEntities(cellDivisor, n_runs, true));
+	}
+}
+
+void GridTuner::report() const
+{
+	const char * names[2] = { "GRID", "HGRID" };
+	const std::vector<GridTuneResult> * results[2] = { &m_entityResults, &m_entityHResults };
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		LOG_INFO("GridTuner: entityGrid (%s), level %s:", names[i], m_level->getName().c_str());
+
+		for (const GridTuneResult & r : *results[i])
+		{
+			const double queries = static_cast<double>(std::max<uint64_t>(r.stats.queries, 1));
+
+			LOG_INFO(
+				"GridTuner: cellDivisor %4d | %8.3f ms | cells %6u/%6u | items/cell min %4u avg %7.2f max %4u | candidates/query %7.2f, overlaps/query %7.2f",
+				r.cellDivisor, r.timeMs,
+				r.stats.cellsUsed, r.stats.cells,
+				r.stats.minItems, r.stats.avgItems, r.stats.maxItems,
+				r.stats.candidates / queries, r.overlaps / queries
+			);
+		}
+
+		LOG_INFO("GridTuner: entityGrid (%s), level %s, recommended cellDivisor: %d", names[i], m_level->getName().c_str(), bestOf(*results[i]));
+	}
+}
+
+// Writes the cell size recommended for the level's own broadphase, nothing
+// else in the level file is touched
+void GridTuner::writeBack()
+{
+	const EntityBroadphase broadphase = m_level->getEntityBroadphase();
+	const std::vector<GridTuneResult> & results = (broadphase == EB_HGRID) ? m_entityHResults : m_entityResults;
+
+	if (broadphase == EB_SAP || results.empty())
+	{
+		LOG_INFO("GridTuner: Level %s has no entity grid to write back.", m_level->getName().c_str());
+		return;
+	}
+
+	m_level->saveJsonValue("entityGrid", "cellDivisor", bestOf(results));
+}
+
+const std::vector<GridTuneResult> & GridTuner::getEntityResults() const
+{
+	return m_entityResults;
+}
+
+const std::vector<GridTuneResult> & GridTuner::getEntityHResults() const
+{
+	return m_entityHResults;
+}
+
+int32_t GridTuner::getBestEntityCellDivisor() const
+{
+	return bestOf(m_entityResults);
+}
+
+int32_t GridTuner::getBestEntityHCellDivisor() const
+{
+	return bestOf(m_entityHResults);
+}
+
+void GridTuner::buildWorkload(uint32_t n_queries)
+{
+	std::vector<Entity *> & entities = m_level->getEntityVector();
+
+	m_entityCrowd.clear();
+	m_entitySteps.clear();
+	if (entities.empty())
+	{
+		m_entityTicks = 0;
+		return;
+	}
+
+	std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+	for (uint32_t i = 0; i < TUNER_CROWD_SIZE; i++)
+	{
+		m_entityCrowd.push_back(randomPlacement(entities[i % entities.size()]->getPhysAABB()));
+		m_entitySteps.push_back(vec2(step(m_rng), step(m_rng)));
+	}
+
+	m_entityTicks = std::max(n_queries / TUNER_CROWD_SIZE, 1u);
+}
+
+// Moves the crowd around for m_entityTicks ticks, returns the overlaps found
+template<typename G>
+uint64_t GridTuner::runCrowd(G & grid, double & timeMs)
+{
+	const AABB bounds = m_level->getAABB();
+	std::vector<AABB> crowd(m_entityCrowd);
+	std::vector<vec2> steps(m_entitySteps);
+	std::vector<uint32_t> handles;
+	uint64_t n_overlaps = 0;
+
+	for (uint32_t i = 0; i < crowd.size(); i++)
+	{
+		handles.push_back(grid.insertData(crowd[i], i));
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t tick = 0; tick < m_entityTicks; tick++)
+	{
+		for (uint32_t i = 0; i < crowd.size(); i++)
+		{
+			// Bounce off the level edges
+			const AABB next = crowd[i] + steps[i];
+			if (!overlaps(next, bounds))
+				steps[i] = steps[i].negate();
+
+			crowd[i] = crowd[i] + steps[i];
+			grid.moveData(handles[i], crowd[i]);
+		}
+
+		for (uint32_t i = 0; i < crowd.size(); i++)
+		{
+			grid.visitOverlappingData(crowd[i], [&](uint32_t j)
+			{
+				if (i < j && overlaps(crowd[i], crowd[j]))
+					n_overlaps++;
+			});
+		}
+	}
+
+	timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return n_overlaps;
+}
+
+GridTuneResult GridTuner::runEntities(int32_t cellDivisor, uint32_t n_runs, bool hierarchical)
+{
+	GridTuneResult result = GridTuneResult{ cellDivisor, 0.0, 0, GridStats() };
+	const AABB bounds = m_level->getAABB();
+
+	for (uint32_t run = 0; run < n_runs; run++)
+	{
+		double timeMs = 0.0;
+
+		if (hierarchical)
+		{
+			HierarchicalGrid<uint32_t> grid(cellDivisor, m_entityLevels, bounds, m_entityStorage);
+			result.overlaps = runCrowd(grid, timeMs);
+			result.stats = grid.getStats();
+		}
+		else
+		{
+			Grid<uint32_t> grid(cellDivisor, bounds, m_entityStorage);
+			result.overlaps = runCrowd(grid, timeMs);
+			result.stats = grid.getStats();
+		}
+
+		// Keep the fastest run, the rest are warm up & noise
+		if (run == 0 || timeMs < result.timeMs)
+			result.timeMs = timeMs;
+	}
+
+	return result;
+}
+
+AABB GridTuner::randomPlacement(const AABB & aabb)
+{
+	const AABB bounds = m_level->getAABB();
+	std::uniform_real_distribution<float> x(bounds.getMinP().x, bounds.getMaxP().x);
+	std::uniform_real_distribution<float> y(bounds.getMinP().y, bounds.getMaxP().y);
+
+	return aabb - aabb.getMinP() + vec2(x(m_rng), y(m_rng));
+}
+
+int32_t GridTuner::bestOf(const std::vector<GridTuneResult> & results)
+{
+	if (results.empty())
+		return 0;
+
+	return std::min_element(results.begin(), results.end(), [](const GridTuneResult & a, const GridTuneResult & b)
+	{
+		return a.timeMs < b.timeMs;
+	})->cellDivisor;
+}
@@ -0,0 +1,55 @@
+#ifndef GRIDTUNER_H
+#define GRIDTUNER_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "grid.h"
+#include "hgrid.h"
+#include "aabb.h"
+
+class Level;
+
+struct GridTuneResult
+{
+	int32_t cellDivisor;
+	double timeMs;
+	uint64_t overlaps;
+	GridStats stats;
+};
+
+// Replays a synthetic query workload over a level's entities at several
+// cell sizes and picks the fastest one for the flat & the hierarchical
+// entity grid. The workload moves a crowd of the level's entities around
+// and queries each of them once per tick, like Level::update does.
+class GridTuner
+{
+public:
+	GridTuner(Level * const level, uint32_t seed = 17);
+	void tune(const std::vector<int32_t> & cellDivisors, uint32_t n_queries, uint32_t n_runs = 3);
+	void report() const;
+	void writeBack();
+	const std::vector<GridTuneResult> & getEntityResults() const;
+	const std::vector<GridTuneResult> & getEntityHResults() const;
+	int32_t getBestEntityCellDivisor() const;
+	int32_t getBestEntityHCellDivisor() const;
+private:
+	void buildWorkload(uint32_t n_queries);
+	GridTuneResult runEntities(int32_t cellDivisor, uint32_t n_runs, bool hierarchical);
+	template<typename G>
+	uint64_t runCrowd(G & grid, double & timeMs);
+	AABB randomPlacement(const AABB & aabb);
+	static int32_t bestOf(const std::vector<GridTuneResult> & results);
+
+	Level * const m_level;
+	std::mt19937 m_rng;
+	GridStorage m_entityStorage;
+	int32_t m_entityLevels;
+	std::vector<AABB> m_entityCrowd;
+	std::vector<vec2> m_entitySteps;
+	uint32_t m_entityTicks;
+	std::vector<GridTuneResult> m_entityResults;
+	std::vector<GridTuneResult> m_entityHResults;
+};
+
+#endif // GRIDTUNER_H
@@ -0,0 +1,166 @@
+#ifndef HGRID_H
+#define HGRID_H
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include "grid.h"
+#include "aabb.h"
+#include "macros.h"
+
+// Stable reference to an item inserted into a HierarchicalGrid
+typedef uint32_t HGridHandle;
+
+// Stack of uniform grids, cell size doubling per level. Every item lives in
+// the finest level whose cells are at least as large as its AABB, so an
+// item spans at most 2x2 cells no matter its size.
+template<typename T>
+class HierarchicalGrid
+{
+	struct HGridLocation
+	{
+		uint32_t level;
+		GridHandle handle;
+		T data;
+	};
+
+public:
+	HierarchicalGrid(const int32_t cellDivisor, const int32_t levels, const AABB & bounds, GridStorage storage = GS_HASH) :
+		m_cellDivisor(cellDivisor),
+		m_grids(),
+		m_locations(),
+		m_freeHandles()
+	{
+		for (int32_t i = 0; i < std::max(levels, 1); i++)
+		{
+			m_grids.push_back(new Grid<T>(cellDivisor << i, bounds, storage));
+		}
+	}
+
+	~HierarchicalGrid()
+	{
+		for (auto g : m_grids)
+		{
+			DELETE_SP(g);
+		}
+	}
+
+	HGridHandle insertData(const AABB & aabb, T data)
+	{
+		HGridHandle handle;
+
+		if (m_freeHandles.empty())
+		{
+			handle = static_cast<HGridHandle>(m_locations.size());
+			m_locations.push_back(HGridLocation{ 0, 0, data });
+		}
+		else
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+
+		const uint32_t level = levelFor(aabb);
+		m_locations[handle] = HGridLocation{ level, m_grids[level]->insertData(aabb, data), data };
+
+		return handle;
+	}
+
+	// Moves the item, changing level only when its size calls for it
+	void moveData(const HGridHandle handle, const AABB & aabb)
+	{
+		assert(handle < m_locations.size());
+
+		HGridLocation & loc = m_locations[handle];
+		const uint32_t level = levelFor(aabb);
+
+		if (level == loc.level)
+		{
+			m_grids[level]->moveData(loc.handle, aabb);
+			return;
+		}
+
+		m_grids[loc.level]->removeData(loc.handle);
+		loc.level = level;
+		loc.handle = m_grids[level]->insertData(aabb, loc.data);
+	}
+
+	void removeData(const HGridHandle handle)
+	{
+		assert(handle < m_locations.size());
+
+		m_grids[m_locations[handle].level]->removeData(m_locations[handle].handle);
+		m_freeHandles.push_back(handle);
+	}
+
+	// Calls visitor(T) once for every item whose cells overlap the AABB,
+	// walking the levels from coarse to fine
+	template<typename F>
+	void visitOverlappingData(const AABB & aabb, F && visitor)
+	{
+		for (size_t i = m_grids.size(); i-- > 0; )
+		{
+			m_grids[i]->visitOverlappingData(aabb, visitor);
+		}
+	}
+
+	// Occupancy & query counters summed over all levels
+	GridStats getStats() const
+	{
+		GridStats stats = GridStats{ 0, 0, 0, 0, 0, 0.0f, 0, 0 };
+
+		for (const Grid<T> * g : m_grids)
+		{
+			const GridStats s = g->getStats();
+
+			if (s.cellsUsed > 0)
+			{
+				stats.minItems = (stats.cellsUsed == 0) ? s.minItems : std::min(stats.minItems, s.minItems);
+				stats.maxItems = std::max(stats.maxItems, s.maxItems);
+			}
+
+			stats.cells += s.cells;
+			stats.cellsUsed += s.cellsUsed;
+			stats.items += s.items;
+			stats.queries += s.queries;
+			stats.candidates += s.candidates;
+		}
+
+		if (stats.cellsUsed > 0)
+			stats.avgItems = static_cast<float>(stats.items) / stats.cellsUsed;
+
+		return stats;
+	}
+
+	size_t getLevels() const
+	{
+		return m_grids.size();
+	}
+
+	Grid<T> * getLevel(size_t level)
+	{
+		return m_grids[level];
+	}
+
+private:
+	uint32_t levelFor(const AABB & aabb) const
+	{
+		const float size = std::max(aabb.getMaxP().x - aabb.getMinP().x, aabb.getMaxP().y - aabb.getMinP().y);
+		uint32_t level = 0;
+
+		while (level + 1 < m_grids.size() && static_cast<float>(m_cellDivisor << level) < size)
+		{
+			level++;
+		}
+
+		return level;
+	}
+
+	const int32_t m_cellDivisor;
+	std::vector<Grid<T> *> m_grids;
+	std::vector<HGridLocation> m_locations;
+	std::vector<HGridHandle> m_freeHandles;
+};
+
+#endif // HGRID_H
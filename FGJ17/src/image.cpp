@@ -3,34 +3,43 @@
 #include "display.h"
 #include "resmanager.h"
 
-Image::Image(SDL_Texture * texture, int32_t width, int32_t height) :
+Image::Image(const TextureRegion * texture, int32_t width, int32_t height) :
 	m_srcImage(texture),
 	m_srcRect{ 0, 0, width, height }
 {
-	if (m_srcRect.w <= 0 || m_srcRect.h <= 0)
-		SDL_QueryTexture(m_srcImage, NULL, NULL, &m_srcRect.w, &m_srcRect.h);
+	if (m_srcImage != nullptr && (m_srcRect.w <= 0 || m_srcRect.h <= 0))
+	{
+		m_srcRect.w = m_srcImage->w;
+		m_srcRect.h = m_srcImage->h;
+	}
 }
 
 void Image::render(Display * const display, vec2 position)
 {
-	SDL_Rect sourceRect = { m_srcRect.x, m_srcRect.y, m_srcRect.w, m_srcRect.h };
+	if (m_srcImage == nullptr)
+		return;
+
+	SDL_Rect sourceRect = { m_srcImage->x + m_srcRect.x, m_srcImage->y + m_srcRect.y, m_srcRect.w, m_srcRect.h };
 	SDL_Rect destinationRect = {
 		static_cast<int32_t>(std::round(position.x)),
 		static_cast<int32_t>(std::round(position.y)),
 		m_srcRect.w, m_srcRect.h
 	};
-	display->drawImage(m_srcImage, &sourceRect, &destinationRect, position, true);
+	display->drawImage(m_srcImage->texture, &sourceRect, &destinationRect, true);
 }
 
 void Image::renderRepeat(Display * const display, vec2 position, int32_t width, int32_t height)
 {
-	SDL_Rect sourceRect = { m_srcRect.x, m_srcRect.y, m_srcRect.w, m_srcRect.h };
+	if (m_srcImage == nullptr)
+		return;
+
+	SDL_Rect sourceRect = { m_srcImage->x + m_srcRect.x, m_srcImage->y + m_srcRect.y, m_srcRect.w, m_srcRect.h };
 	SDL_Rect destinationRect = {
 		static_cast<int32_t>(std::round(position.x)),
 		static_cast<int32_t>(std::round(position.y)),
 		m_srcRect.w, m_srcRect.h
 	};
-	display->drawImageRepeat(m_srcImage, &sourceRect, &destinationRect, position, width, height, true);
+	display->drawImageRepeat(m_srcImage->texture, &sourceRect, &destinationRect, width, height, true);
 }
 
 void Image::renderOutline(Display * const display, vec2 position)
@@ -5,13 +5,14 @@
 #include <cstdint>
 #include <string>
 #include "vec2.h"
+#include "textureatlas.h"
 
 class Display;
 
 class Image
 {
 public:
-	Image(SDL_Texture * texture, int32_t width = 0, int32_t height = 0);
+	Image(const TextureRegion * texture, int32_t width = 0, int32_t height = 0);
 	void render(Display * const display, vec2 position = vec2(0, 0));
 	void renderRepeat(Display * const display, vec2 position = vec2(0, 0), int32_t width = 0, int32_t height = 0);
 	void renderOutline(Display * const display, vec2 position = vec2(0, 0));
@@ -23,7 +24,7 @@ public:
 	int32_t getHeight() const;
 	vec2 getDimensions() const;
 private:
-	SDL_Texture * m_srcImage;
+	const TextureRegion * m_srcImage;
 	SDL_Rect m_srcRect;
 };
 
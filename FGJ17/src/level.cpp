@@ -1,5 +1,6 @@
 #include "level.h"
 #include <fstream>
+#include <sstream>
 #include "macros.h"
 #include "tools.h"
 #include "game.h"
@@ -7,6 +8,8 @@
 #include "display.h"
 #include "image.h"
 #include "tile.h"
+#include "tilebitmap.h"
+#include "tilechunkcache.h"
 #include "tmxmap.h"
 #include "entity.h"
 #include "player.h"
@@ -27,26 +30,44 @@ Level::Level(
 	m_height(m_tmxMap->getMapData().height * m_tileHeight),
 	m_aabb(vec2(0, 0), vec2(static_cast<float>(m_width), static_cast<float>(m_height))),
 	m_gravity(),
+	m_prevCamera(),
 	m_camera(),
 	m_player(nullptr),
-	m_tileGrid(nullptr),
+	m_tileBitmap(nullptr),
+	m_tileChunks(nullptr),
 	m_entityGrid(nullptr),
+	m_entitySap(nullptr),
+	m_entityHGrid(nullptr),
+	m_entityBroadphase(EB_GRID),
 	m_entityVector(),
-	m_bgImgVector()
+	m_entityHandles(),
+	m_entitySwept(),
+	m_entityPairs(),
+	m_bgImgVector(),
+	m_viewExtent(),
+	m_snapshots()
 {
-	// Load level JSON file
-	std::string jsonFilePath("./data/levels/" + m_name + ".json");
-	std::ifstream jsonFile(jsonFilePath, std::ifstream::binary);
-
-	// Throw if loading JSON data failed
-	if (jsonFile.is_open() == false)
+	if (!m_tmxMap->getLevelJson().empty())
 	{
-		throw std::exception(std::string("Error: Can't find JSON data for given level. Filepath: " + jsonFilePath).c_str());
+		// Cooked levels carry their JSON
+		m_json = json::parse(m_tmxMap->getLevelJson());
 	}
+	else
+	{
+		// Load level JSON file
+		std::string jsonFilePath("./data/levels/" + m_name + ".json");
+		std::ifstream jsonFile(jsonFilePath, std::ifstream::binary);
 
-	// Assign the contents of JSON file to level's JSON object
-	jsonFile >> m_json;
-	jsonFile.close();
+		// Throw if loading JSON data failed
+		if (jsonFile.is_open() == false)
+		{
+			throw std::exception(std::string("Error: Can't find JSON data for given level. Filepath: " + jsonFilePath).c_str());
+		}
+
+		// Assign the contents of JSON file to level's JSON object
+		jsonFile >> m_json;
+		jsonFile.close();
+	}
 
 	// Get level JSON object
 	json & json_level = m_json["level"];
@@ -57,20 +78,42 @@ Level::Level(
 		json_level["gravity"]["y"].get<float>()
 	);
 
-	// Parse level tile grid
-	m_tileGrid = new Grid<Tile *>(json_level["tileGrid"]["cellDivisor"].get<int32_t>());
-
 	// Parse level entity grid
-	m_entityGrid = new Grid<Entity *>(json_level["entityGrid"]["cellDivisor"].get<int32_t>());
+	m_entityGrid = new Grid<uint32_t>(
+		json_level["entityGrid"]["cellDivisor"].get<int32_t>(),
+		m_aabb,
+		strToGridStorage(json_level["entityGrid"]["storage"].get<std::string>())
+	);
 
-	// Parse all tile layers
-	for (auto & l : m_tmxMap->getMapData().layer)
+	// Parse level entity broadphase
+	m_entityBroadphase = strToBroadphase(json_level["entityBroadphase"].get<std::string>());
+	if (m_entityBroadphase == EB_SAP)
 	{
-		// Parse tiles per layer
-		for (auto & t : l.tiles)
-		{
-			m_tileGrid->insertData(t.getAABB().getCenterP(), &t);
-		}
+		m_entitySap = new SweepAndPrune<uint32_t>();
+	}
+	else if (m_entityBroadphase == EB_HGRID)
+	{
+		// Levels double the entity grid cell size, finest first
+		m_entityHGrid = new HierarchicalGrid<uint32_t>(
+			json_level["entityGrid"]["cellDivisor"].get<int32_t>(),
+			json_level["entityGrid"]["levels"].get<int32_t>(),
+			m_aabb,
+			strToGridStorage(json_level["entityGrid"]["storage"].get<std::string>())
+		);
+	}
+
+	// Build tile class bitmap for collisions
+	m_tileBitmap = new TileBitmap(m_tmxMap->getMapData());
+
+	// Parse level tile chunk cache, tiles are drawn one by one without render target support
+	if (m_game->getDisplay()->getRenderTargetSupported())
+	{
+		m_tileChunks = new TileChunkCache(
+			m_game->getDisplay(),
+			m_tmxMap->getMapData(),
+			json_level["tileChunkCache"]["chunkTiles"].get<int32_t>(),
+			json_level["tileChunkCache"]["capacity"].get<uint32_t>()
+		);
 	}
 
 	// Parse all object groups
@@ -86,8 +129,8 @@ Level::Level(
 				// Entity position
 				vec2 entity_pos(static_cast<float>(o.x), static_cast<float>(o.y));
 
-				// Entity properties
-				EntityProperties entity_props = Entity::strToProperties(o.objectproperties);
+				// Entity properties, resolved by the map loader
+				EntityProperties entity_props = o.properties;
 
 				// Player entity
 				switch (cstr2int(o.type.c_str()))
@@ -106,6 +149,36 @@ Level::Level(
 	// Player is always the first entity
 	m_player = m_entityVector.back();
 
+	// Insert entities into the broadphase by their entity vector index, moved
+	// incrementally from now on
+	for (uint32_t i = 0; i < m_entityVector.size(); i++)
+	{
+		const AABB aabb = m_entityVector[i]->getPhysAABB();
+
+		if (m_entityBroadphase == EB_SAP)
+			m_entityHandles.push_back(m_entitySap->insertData(aabb, i));
+		else if (m_entityBroadphase == EB_HGRID)
+			m_entityHandles.push_back(m_entityHGrid->insertData(aabb, i));
+		else
+			m_entityHandles.push_back(m_entityGrid->insertData(aabb, i));
+	}
+
+	if (m_entityBroadphase == EB_SAP)
+		m_entitySap->update();
+
+	// Visible area around the camera, padded by a tile for movement between
+	// capture & render. The window size is fixed, the display itself may be
+	// drawing into a render target on another thread.
+	m_viewExtent = vec2(
+		static_cast<float>(m_game->getDisplay()->getWidth()) * 0.5f / static_cast<float>(m_game->getDisplay()->getScale()) + m_tileWidth,
+		static_cast<float>(m_game->getDisplay()->getHeight()) * 0.5f / static_cast<float>(m_game->getDisplay()->getScale()) + m_tileHeight
+	);
+
+	// Initial state for frames rendered before the first tick
+	m_prevCamera = m_camera = m_player->getPhysAABB().getCenterP();
+	m_snapshots.back().t = 0.0;
+	captureSnapshot();
+
 	// Build bgimagevector
 	for (TmxImgLayerData &l : m_tmxMap->getMapData().imglayer)
 	{
@@ -124,71 +197,144 @@ Level::~Level()
 	{
 		DELETE_SP(e);
 	}
+
+	DELETE_SP(m_entityHGrid);
+	DELETE_SP(m_entitySap);
+	DELETE_SP(m_entityGrid);
+	DELETE_SP(m_tileChunks);
+	DELETE_SP(m_tileBitmap);
 }
 
 void Level::update(double t, double dt)
 {
 	//m_entityVector.push_back(new Box(m_game, m_player->getPosition(), EntityProperties()));
 
-	// Rebuild entity grid
-	m_entityGrid->clearData();
+	// Update entities, movement & tile collisions
 	for (Entity * e : m_entityVector)
 	{
-		m_entityGrid->insertData(e->getPhysAABB().getCenterP(), e);
+		e->update(*this, t, dt);
 	}
 
-	// Update entities
-	for (Entity * e : m_entityVector)
+	// Refresh the entity broadphase with this tick's swept AABBs
+	m_entitySwept.resize(m_entityVector.size());
+	for (size_t i = 0; i < m_entityVector.size(); i++)
 	{
-		e->update(*this, t, dt);
+		const Entity * e = m_entityVector[i];
+		const AABB & aabb = m_entitySwept[i] = e->getPhysAABB().sweep(e->getVelocity() * static_cast<float>(dt));
+
+		if (m_entityBroadphase == EB_SAP)
+			m_entitySap->moveData(m_entityHandles[i], aabb);
+		else if (m_entityBroadphase == EB_HGRID)
+			m_entityHGrid->moveData(m_entityHandles[i], aabb);
+		else
+			m_entityGrid->moveData(m_entityHandles[i], aabb);
+	}
+
+	// Generate unique pairs of entities whose swept AABBs overlap, the same
+	// for every broadphase
+	m_entityPairs.clear();
+	if (m_entityBroadphase == EB_SAP)
+	{
+		m_entitySap->update();
+		m_entitySap->visitPairs([&](uint32_t i, uint32_t j)
+		{
+			m_entityPairs.push_back((i < j) ? EntityPair(i, j) : EntityPair(j, i));
+		});
+	}
+	else
+	{
+		for (uint32_t i = 0; i < m_entitySwept.size(); i++)
+		{
+			// Grid cells only narrow down the candidates, and both entities of
+			// a pair find each other, keep only one of them
+			visitEntityIndices(m_entitySwept[i], [&](uint32_t j)
+			{
+				if (i < j && m_entitySwept[i].collidesX(m_entitySwept[j]) && m_entitySwept[i].collidesY(m_entitySwept[j]))
+					m_entityPairs.push_back(EntityPair(i, j));
+			});
+		}
+	}
+
+	// Resolve entity pairs in entity order, so the outcome does not depend on
+	// the broadphase or on where entities live in memory
+	std::sort(m_entityPairs.begin(), m_entityPairs.end());
+	for (const EntityPair & p : m_entityPairs)
+	{
+		Entity::resolveCollision(*m_entityVector[p.first], *m_entityVector[p.second], dt);
 	}
 
 	// Update camera
+	m_prevCamera = m_camera;
 	m_camera = m_player->getPhysAABB().getCenterP();
+
+	// Publish the render state of this tick
+	m_snapshots.back().t = t;
+	captureSnapshot();
 }
 
 void Level::render(Display * const display)
 {
+	// Latest published simulation state, drawn between its previous & current
+	// tick by how far we are into the next tick. This lags a tick behind but
+	// hides the beat between tick & frame rate.
+	const LevelSnapshot & snapshot = m_snapshots.acquire();
+	const double tickTime = m_game->getTickTimeInMs() * 1e-3;
+	const float alpha = static_cast<float>(std::min(std::max((m_game->getCurrentTimeInMs() * 1e-3 - snapshot.t) / tickTime, 0.0), 1.0));
+	const vec2 camera = snapshot.prevCamera + (snapshot.camera - snapshot.prevCamera) * alpha;
+
 	// Display offset for rendering, centered
 	vec2 offset(
-		m_camera.negate() +
+		camera.negate() +
 		vec2(static_cast<float>(display->getWidth()) * 0.5f, static_cast<float>(-display->getHeight()) * 0.5f) / static_cast<float>(display->getScale())
 	);
 	display->setOffset(offset);
 
-	// Render tiles, background pass
-	std::vector<Tile *> tilesToRenderBg;
-	std::vector<Tile *> tilesToRenderFg;
-	if (m_tileGrid->getNearestData(m_camera, m_game->getRenderDistance(), tilesToRenderBg))
+	// Exact visible area & the tile range it covers, tiles only touching its edges are skipped
+	const AABB view = display->getView();
+	const int32_t tx0 = static_cast<int32_t>(std::floor(view.getMinP().x / m_tileWidth));
+	const int32_t ty0 = static_cast<int32_t>(std::floor(view.getMinP().y / m_tileHeight));
+	const int32_t tx1 = static_cast<int32_t>(std::ceil(view.getMaxP().x / m_tileWidth)) - 1;
+	const int32_t ty1 = static_cast<int32_t>(std::ceil(view.getMaxP().y / m_tileHeight)) - 1;
+
+	// Render tiles, background pass, baked tile chunks when available
+	if (m_tileChunks != nullptr)
+	{
+		m_tileChunks->render(view, TL_BACKGROUND);
+	}
+	else
 	{
-		for (Tile * t : tilesToRenderBg)
+		for (TmxLayerData & l : m_tmxMap->getMapData().layer)
 		{
-			if (t->getLayer() != TL_BACKGROUND)
-			{
-				tilesToRenderFg.push_back(t);
-			}
-			else
-			{
-				t->render(display);
-			}
+			if (l.layer == TL_BACKGROUND)
+				l.visitTiles(tx0, ty0, tx1, ty1, [&](const Tile & t) { t.render(display); });
 		}
 	}
+	display->flush();
 
-	// Render entities
-	std::vector<Entity *> entitiesToRender;
-	if (m_entityGrid->getNearestData(m_camera, m_game->getRenderDistance(), entitiesToRender))
+	// Render entities whose sprite is in view
+	for (const EntitySnapshot & e : snapshot.entities)
 	{
-		for (Entity * e : entitiesToRender)
-		{
-			e->render(display);
-		}
+		const vec2 position = e.lerpPosition(alpha);
+
+		if (view.intersects(AABB(position, position + e.dimensions)))
+			Entity::renderSnapshot(display, e, alpha);
 	}
+	display->flush();
 
-	// Render tiles, foreground
-	for (Tile * t : tilesToRenderFg)
+	// Render tiles, foreground pass
+	if (m_tileChunks != nullptr)
 	{
-		t->render(display);
+		m_tileChunks->render(view, TL_FOREGROUND);
 	}
+	else
+	{
+		for (TmxLayerData & l : m_tmxMap->getMapData().layer)
+		{
+			if (l.layer != TL_BACKGROUND)
+				l.visitTiles(tx0, ty0, tx1, ty1, [&](const Tile & t) { t.render(display); });
+		}
+	}
+	display->flush();
 
 	// Reset display offset
 	display->setOffset(vec2(0, 0));
@@ -209,11 +355,113 @@ void Level::setCamera(const vec2 & v)
 	m_camera = v;
 }
 
+// Broadphase culled render state of the entities around the camera
+void Level::captureSnapshot()
+{
+	LevelSnapshot & snapshot = m_snapshots.back();
+	const AABB view(m_camera - m_viewExtent, m_camera + m_viewExtent);
+
+	snapshot.prevCamera = m_prevCamera;
+	snapshot.camera = m_camera;
+	snapshot.entities.clear();
+	visitEntities(view, [&](Entity * e)
+	{
+		snapshot.entities.push_back(e->getSnapshot());
+	});
+	snapshot.entityCount = m_entityVector.size();
+	snapshot.player = PlayerSnapshot{
+		m_player->getState(),
+		m_player->getCurrentTileClasses(),
+		m_player->getCurrentEntityCollisions().size(),
+		m_player->getPosition(),
+		m_player->getVelocity(),
+		m_player->getMoveDirX(),
+		m_player->getMoveDirY()
+	};
+
+	m_snapshots.publish();
+}
+
+// Tiles within the AABB changed, their baked chunks must be redrawn
+void Level::invalidateTiles(const AABB & aabb)
+{
+	if (m_tileChunks != nullptr)
+		m_tileChunks->invalidate(aabb);
+}
+
+// Sets level.<object>.<key> to the integer value & rewrites just that value
+// in the level's JSON file, leaving the rest of the file as written
+bool Level::saveJsonValue(const std::string & object, const std::string & key, int32_t value)
+{
+	std::string jsonFilePath("./data/levels/" + m_name + ".json");
+	std::ifstream jsonInFile(jsonFilePath, std::ifstream::binary);
+
+	if (jsonInFile.is_open() == false)
+	{
+		LOG_ERROR("Level: Can't read JSON data for level %s. Filepath: %s", m_name.c_str(), jsonFilePath.c_str());
+		return false;
+	}
+
+	std::stringstream contents;
+	contents << jsonInFile.rdbuf();
+	jsonInFile.close();
+	std::string text = contents.str();
+
+	// Find "object": { ... "key": <number> ... } & the span of the number
+	const size_t objectPos = text.find("\"" + object + "\"");
+	const size_t openPos = (objectPos != std::string::npos) ? text.find('{', objectPos) : std::string::npos;
+	const size_t closePos = (openPos != std::string::npos) ? text.find('}', openPos) : std::string::npos;
+	const size_t keyPos = (openPos != std::string::npos) ? text.find("\"" + key + "\"", openPos) : std::string::npos;
+	const size_t colonPos = (keyPos < closePos) ? text.find(':', keyPos) : std::string::npos;
+	const size_t valueBegin = (colonPos < closePos) ? text.find_first_not_of(" \t\r\n", colonPos + 1) : std::string::npos;
+	const size_t valueEnd = (valueBegin < closePos) ? text.find_first_not_of("-+0123456789.eE", valueBegin) : std::string::npos;
+
+	if (valueEnd == std::string::npos || valueEnd == valueBegin)
+	{
+		LOG_ERROR("Level: No number at level.%s.%s in JSON data for level %s.", object.c_str(), key.c_str(), m_name.c_str());
+		return false;
+	}
+
+	text.replace(valueBegin, valueEnd - valueBegin, std::to_string(value));
+
+	std::ofstream jsonOutFile(jsonFilePath, std::ofstream::binary);
+
+	if (jsonOutFile.is_open() == false)
+	{
+		LOG_ERROR("Level: Can't write JSON data for level %s. Filepath: %s", m_name.c_str(), jsonFilePath.c_str());
+		return false;
+	}
+
+	jsonOutFile << text;
+	jsonOutFile.close();
+
+	m_json["level"][object][key] = value;
+
+	LOG_INFO("Level: Saved level.%s.%s = %d for level %s.", object.c_str(), key.c_str(), value, m_name.c_str());
+
+	return true;
+}
+
 Game * const Level::getGame() const
 {
 	return m_game;
 }
 
+const std::string & Level::getName() const
+{
+	return m_name;
+}
+
+json & Level::getJson()
+{
+	return m_json;
+}
+
+TmxMap * const Level::getTmxMap() const
+{
+	return m_tmxMap;
+}
+
 AABB Level::getAABB() const
 {
 	return m_aabb;
@@ -234,16 +482,42 @@ Entity * const Level::getPlayer()
 	return m_player;
 }
 
-Grid<Tile *> * Level::getTileGrid()
+TileBitmap * Level::getTileBitmap()
+{
+	return m_tileBitmap;
+}
+
+TileChunkCache * Level::getTileChunks()
+{
+	return m_tileChunks;
+}
+
+// State drawn by the last render()
+const LevelSnapshot & Level::getSnapshot() const
 {
-	return m_tileGrid;
+	return m_snapshots.front();
 }
 
-Grid<Entity *> * Level::getEntityGrid()
+Grid<uint32_t> * Level::getEntityGrid()
 {
 	return m_entityGrid;
 }
 
+SweepAndPrune<uint32_t> * Level::getEntitySap()
+{
+	return m_entitySap;
+}
+
+HierarchicalGrid<uint32_t> * Level::getEntityHGrid()
+{
+	return m_entityHGrid;
+}
+
+EntityBroadphase Level::getEntityBroadphase() const
+{
+	return m_entityBroadphase;
+}
+
 std::vector<Entity *> & Level::getEntityVector()
 {
 	return m_entityVector;
@@ -4,18 +4,57 @@
 #include <string>
 #include <vector>
 #include "3rdparty/json.hpp"
+#include "tools.h"
 #include "vec2.h"
 #include "grid.h"
+#include "hgrid.h"
+#include "sweepprune.h"
+#include "snapshotbuffer.h"
 #include "aabb.h"
+#include "entity.h"
 
 using json = nlohmann::json;
 
 class Game;
 class Display;
 class Image;
-class Tile;
+class TileBitmap;
+class TileChunkCache;
 class TmxMap;
-class Entity;
+
+// Indices into the level entity vector, lower index first
+typedef std::pair<uint32_t, uint32_t> EntityPair;
+
+// Player state shown by the debug overlay
+struct PlayerSnapshot
+{
+	EntityState state;
+	uint32_t tileClasses;
+	size_t entityCollisions;
+	vec2 position;
+	vec2 velocity;
+	EntityMoveDirX moveDirX;
+	EntityMoveDirY moveDirY;
+};
+
+// Everything Level::render needs from the simulation, captured once per
+// tick so rendering never touches live entity state
+struct LevelSnapshot
+{
+	double t;
+	vec2 prevCamera;
+	vec2 camera;
+	std::vector<EntitySnapshot> entities;
+	size_t entityCount;
+	PlayerSnapshot player;
+};
+
+enum EntityBroadphase : uint8_t
+{
+	EB_GRID = 0,
+	EB_SAP = 1,
+	EB_HGRID = 2
+};
 
 class Level
 {
@@ -31,16 +70,69 @@ public:
 	void setGravity(const vec2 & v);
 	void moveCamera(const vec2 & v);
 	void setCamera(const vec2 & v);
+	void invalidateTiles(const AABB & aabb);
+	bool saveJsonValue(const std::string & object, const std::string & key, int32_t value);
 	Game * const getGame() const;
+	const std::string & getName() const;
+	json & getJson();
+	TmxMap * const getTmxMap() const;
 	AABB getAABB() const;
 	vec2 getGravity() const;
 	vec2 getCamera() const;
 	Entity * const getPlayer();
-	Grid<Tile *> * getTileGrid();
-	Grid<Entity *> * getEntityGrid();
+	TileBitmap * getTileBitmap();
+	TileChunkCache * getTileChunks();
+	const LevelSnapshot & getSnapshot() const;
+	Grid<uint32_t> * getEntityGrid();
+	SweepAndPrune<uint32_t> * getEntitySap();
+	HierarchicalGrid<uint32_t> * getEntityHGrid();
+	EntityBroadphase getEntityBroadphase() const;
 	std::vector<Entity *> & getEntityVector();
 	std::vector<Image *> & getBgImgVector();
+
+	// Calls visitor(uint32_t) with the entity vector index of every entity
+	// the broadphase finds near the AABB
+	template<typename F>
+	void visitEntityIndices(const AABB & aabb, F && visitor)
+	{
+		if (m_entityBroadphase == EB_SAP)
+			m_entitySap->visitOverlappingData(aabb, visitor);
+		else if (m_entityBroadphase == EB_HGRID)
+			m_entityHGrid->visitOverlappingData(aabb, visitor);
+		else
+			m_entityGrid->visitOverlappingData(aabb, visitor);
+	}
+
+	// Calls visitor(Entity *) for every entity the broadphase finds near the AABB
+	template<typename F>
+	void visitEntities(const AABB & aabb, F && visitor)
+	{
+		visitEntityIndices(aabb, [&](uint32_t i)
+		{
+			visitor(m_entityVector[i]);
+		});
+	}
+
+	static EntityBroadphase strToBroadphase(const std::string & str)
+	{
+		// Transform str to uppercase
+		std::string strUpper = str;
+		std::transform(strUpper.begin(), strUpper.end(), strUpper.begin(), ::toupper);
+
+		switch (cstr2int(strUpper.c_str()))
+		{
+		case cstr2int("SAP"):
+			return EB_SAP;
+		case cstr2int("HGRID"):
+			return EB_HGRID;
+		case cstr2int("GRID"):
+		default:
+			return EB_GRID;
+		}
+	}
 private:
+	void captureSnapshot();
+
 	Game * const m_game;
 	json m_json;
 	std::string m_name;
@@ -51,12 +143,22 @@ private:
 	uint32_t m_height;
 	AABB m_aabb;
 	vec2 m_gravity;
+	vec2 m_prevCamera;
 	vec2 m_camera;
 	Entity * m_player;
-	Grid<Tile *> * m_tileGrid;
-	Grid<Entity *> * m_entityGrid;
+	TileBitmap * m_tileBitmap;
+	TileChunkCache * m_tileChunks;
+	Grid<uint32_t> * m_entityGrid;
+	SweepAndPrune<uint32_t> * m_entitySap;
+	HierarchicalGrid<uint32_t> * m_entityHGrid;
+	EntityBroadphase m_entityBroadphase;
 	std::vector<Entity *> m_entityVector;
+	std::vector<uint32_t> m_entityHandles;
+	std::vector<AABB> m_entitySwept;
+	std::vector<EntityPair> m_entityPairs;
 	std::vector<Image *> m_bgImgVector;
+	vec2 m_viewExtent;
+	SnapshotBuffer<LevelSnapshot> m_snapshots;
 };
 
 #endif // LEVEL_H
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <string>
+#include <vector>
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <SDL_mixer.h>
@@ -6,6 +8,7 @@
 #include "display.h"
 #include "resmanager.h"
 #include "game.h"
+#include "cookedlevel.h"
 
 int main(int argc, char *argv[])
 {
@@ -39,9 +42,51 @@ int main(int argc, char *argv[])
 	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
 	LOG("Main: SDL2_mixer Initialized successfully.");
 
+	// Parse command line, --tune-grid [--write] runs the grid tuner instead of the game,
+	// --bench-grid times the grid backends against the old std::map grid instead of the game,
+	// --display <window|software|null> overrides the display backend of config.json,
+	// --cook <level> cooks a level into its binary form, may be given many times
+	bool tuneGrids = false;
+	bool tuneWriteBack = false;
+	bool benchGrids = false;
+	std::string displayBackend;
+	std::vector<std::string> cookLevels;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--tune-grid") == 0)
+			tuneGrids = true;
+		else if (strcmp(argv[i], "--bench-grid") == 0)
+			benchGrids = true;
+		else if (strcmp(argv[i], "--write") == 0)
+			tuneWriteBack = true;
+		else if (strcmp(argv[i], "--display") == 0 && i + 1 < argc)
+			displayBackend = argv[++i];
+		else if (strcmp(argv[i], "--cook") == 0 && i + 1 < argc)
+			cookLevels.push_back(argv[++i]);
+	}
+
+	// Cooking needs no game
+	if (!cookLevels.empty())
+	{
+		for (const std::string & name : cookLevels)
+		{
+			if (!CookedLevel::cook(name))
+				return_code = 1;
+		}
+
+		Mix_Quit();
+		TTF_Quit();
+		SDL_Quit();
+
+		return return_code;
+	}
+
 	// Init & run game
-	Game * game = new Game();
-	return_code = game->run();
+	Game * game = new Game("./data/config.json", displayBackend);
+	if (benchGrids)
+		return_code = game->benchGrids();
+	else
+		return_code = (tuneGrids) ? game->tuneGrids(tuneWriteBack) : game->run();
 
 	// Quit game
 	DELETE_SP(game);
@@ -0,0 +1,106 @@
+#include "mappedfile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#include "macros.h"
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string & filePath) :
+	m_data(nullptr),
+	m_size(0),
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(NULL)
+{
+	m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		return;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL)
+	{
+		ERR("MappedFile: CreateFileMapping Error: " << GetLastError());
+		return;
+	}
+
+	m_data = static_cast<uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		ERR("MappedFile: MapViewOfFile Error: " << GetLastError());
+		return;
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+		UnmapViewOfFile(m_data);
+
+	if (m_mapping != NULL)
+		CloseHandle(m_mapping);
+
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::string & filePath) :
+	m_data(nullptr),
+	m_size(0)
+{
+	const int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void * data = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data != MAP_FAILED)
+		{
+			m_data = static_cast<uint8_t *>(data);
+			m_size = static_cast<size_t>(st.st_size);
+		}
+		else
+		{
+			ERR("MappedFile: mmap Error: " << strerror(errno));
+		}
+	}
+
+	// The mapping keeps the file referenced
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+		munmap(m_data, m_size);
+}
+#endif
+
+bool MappedFile::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+const uint8_t * const MappedFile::getData() const
+{
+	return m_data;
+}
+
+size_t MappedFile::getSize() const
+{
+	return m_size;
+}
@@ -0,0 +1,28 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file, pages are loaded on first touch.
+class MappedFile
+{
+public:
+	MappedFile(const std::string & filePath);
+	~MappedFile();
+	bool isOpen() const;
+	const uint8_t * const getData() const;
+	size_t getSize() const;
+private:
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	uint8_t * m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void * m_file;
+	void * m_mapping;
+#endif
+};
+
+#endif // MAPPEDFILE_H
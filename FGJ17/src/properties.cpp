@@ -0,0 +1,93 @@
+#include "properties.h"
+#include <cstdlib>
+#include "macros.h"
+#include "tools.h"
+
+static uint8_t strToKey(const PropertyKey * keys, uint32_t slots, const char * str, uint8_t unknown)
+{
+	const PropertyKey & key = keys[strhashi(str) % slots];
+
+	if (key.str == nullptr || strcasecmp(key.str, str) != 0)
+		return unknown;
+
+	return key.value;
+}
+
+PropertyName strToPropertyName(const char * str)
+{
+	return static_cast<PropertyName>(strToKey(PROPERTY_NAME_KEYS, PROPERTY_NAME_SLOTS, str, PN_UNKNOWN));
+}
+
+PropertyType strToPropertyType(const char * str)
+{
+	return static_cast<PropertyType>(strToKey(PROPERTY_TYPE_KEYS, PROPERTY_TYPE_SLOTS, str, PT_UNKNOWN));
+}
+
+Properties strToProperties(const PropertiesData & data)
+{
+	Properties props;
+
+	for (auto & prop : data)
+	{
+		// Convert string name to property name
+		PropertyName name = strToPropertyName(prop.first);
+
+		if (name == PN_UNKNOWN)
+		{
+			LOG_ERROR("Properties: Unknown property name: %s! Parsing properties interrupted.", prop.first);
+			return props;
+		}
+
+		// ID & TARGET are integers, the rest are property types
+		if (name == PN_ID || name == PN_TARGET)
+		{
+			char * end = nullptr;
+			int32_t value = static_cast<int32_t>(std::strtol(prop.second, &end, 10));
+
+			if (end == prop.second || *end != '\0')
+			{
+				LOG_ERROR("Properties: Property %s value is not a number: %s! Parsing properties interrupted.", prop.first, prop.second);
+				return props;
+			}
+
+			if (name == PN_ID)
+				props.id = value;
+			else
+				props.target = value;
+		}
+		else
+		{
+			PropertyType type = strToPropertyType(prop.second);
+
+			if (type == PT_UNKNOWN)
+			{
+				LOG_ERROR("Properties: Unknown property value: %s! Parsing properties interrupted.", prop.second);
+				return props;
+			}
+
+			switch (name)
+			{
+			case PN_TYPE:
+				props.type |= 1u << type;
+				break;
+			case PN_TYPE_CUSTOM:
+				props.typeCustom |= 1u << type;
+				break;
+			case PN_ID_CUSTOM:
+				props.idCustom |= 1u << type;
+				break;
+			case PN_TARGET_CUSTOM:
+				props.targetCustom |= 1u << type;
+				break;
+			default:
+				break;
+			}
+		}
+
+		LOG_DEBUG("Properties: Parsed property name: %10s, value: %10s", prop.first, prop.second);
+
+		props.names |= 1u << name;
+	}
+
+	return props;
+}
@@ -0,0 +1,158 @@
+#ifndef PROPERTIES_H
+#define PROPERTIES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+enum PropertyName : uint8_t
+{
+	PN_TYPE = 0,
+	PN_ID = 1,
+	PN_TARGET = 2,
+	PN_TYPE_CUSTOM = 3,
+	PN_ID_CUSTOM = 4,
+	PN_TARGET_CUSTOM = 5,
+	PN_COUNT = 6,
+	PN_UNKNOWN = 0xFF
+};
+
+enum PropertyType : uint8_t
+{
+	PT_SOLID = 0,
+	PT_TRIGGER = 1,
+	PT_GATE = 2,
+	PT_BUTTON = 3,
+	PT_COMPUTER = 4,
+	PT_NORMAL = 5,
+	PT_COUNT = 6,
+	PT_UNKNOWN = 0xFF
+};
+
+// Properties resolved at load time. String valued properties are stored as
+// PropertyType bitmasks, ID & TARGET as plain integers.
+struct Properties
+{
+	uint32_t names;
+	uint32_t type;
+	uint32_t typeCustom;
+	uint32_t idCustom;
+	uint32_t targetCustom;
+	int32_t id;
+	int32_t target;
+
+	Properties() :
+		names(0),
+		type(0),
+		typeCustom(0),
+		idCustom(0),
+		targetCustom(0),
+		id(0),
+		target(0)
+	{
+
+	}
+
+	bool has(PropertyName n) const
+	{
+		return (names & (1u << n)) != 0;
+	}
+
+	bool hasType(PropertyType t) const
+	{
+		return (type & (1u << t)) != 0;
+	}
+
+	bool hasId(int32_t v) const
+	{
+		return has(PN_ID) && id == v;
+	}
+
+	bool hasTarget(int32_t v) const
+	{
+		return has(PN_TARGET) && target == v;
+	}
+};
+
+// Raw name & value pairs as parsed, pointing into the parse buffer. Only
+// valid until the buffer is released, strToProperties resolves them.
+typedef std::pair<const char *, const char *> PropertyData;
+typedef std::vector<PropertyData> PropertiesData;
+
+// ---------------------------------------------------------------------------
+// strhashi
+// Case insensitive variant of cstr2int.
+// ---------------------------------------------------------------------------
+constexpr char toupperc(const char c)
+{
+	return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+constexpr uint32_t strhashi(const char * str, int h = 0)
+{
+	return !str[h] ? 5381 : (strhashi(str, h + 1) * 33) ^ static_cast<uint32_t>(toupperc(str[h]));
+}
+
+// ---------------------------------------------------------------------------
+// PropertyKey tables
+// Perfect hash tables, each key is stored at slot strhashi(str) % slots.
+// Slot placement is verified at compile time below.
+// ---------------------------------------------------------------------------
+struct PropertyKey
+{
+	const char * str;
+	uint8_t value;
+};
+
+constexpr uint32_t PROPERTY_NAME_SLOTS = 10;
+constexpr PropertyKey PROPERTY_NAME_KEYS[PROPERTY_NAME_SLOTS] =
+{
+	{ "ID", PN_ID },
+	{ "TYPE", PN_TYPE },
+	{ "TARGET", PN_TARGET },
+	{ nullptr, PN_UNKNOWN },
+	{ "TARGET_CUSTOM", PN_TARGET_CUSTOM },
+	{ "TYPE_CUSTOM", PN_TYPE_CUSTOM },
+	{ nullptr, PN_UNKNOWN },
+	{ nullptr, PN_UNKNOWN },
+	{ "ID_CUSTOM", PN_ID_CUSTOM },
+	{ nullptr, PN_UNKNOWN }
+};
+
+constexpr uint32_t PROPERTY_TYPE_SLOTS = 18;
+constexpr PropertyKey PROPERTY_TYPE_KEYS[PROPERTY_TYPE_SLOTS] =
+{
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ "BUTTON", PT_BUTTON },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ "GATE", PT_GATE },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ "SOLID", PT_SOLID },
+	{ nullptr, PT_UNKNOWN },
+	{ "COMPUTER", PT_COMPUTER },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ nullptr, PT_UNKNOWN },
+	{ "NORMAL", PT_NORMAL },
+	{ "TRIGGER", PT_TRIGGER }
+};
+
+constexpr bool propertyKeysValid(const PropertyKey * keys, uint32_t slots, uint32_t i = 0)
+{
+	return i == slots || ((keys[i].str == nullptr || strhashi(keys[i].str) % slots == i) && propertyKeysValid(keys, slots, i + 1));
+}
+
+static_assert(propertyKeysValid(PROPERTY_NAME_KEYS, PROPERTY_NAME_SLOTS), "PROPERTY_NAME_KEYS slot mismatch");
+static_assert(propertyKeysValid(PROPERTY_TYPE_KEYS, PROPERTY_TYPE_SLOTS), "PROPERTY_TYPE_KEYS slot mismatch");
+
+PropertyName strToPropertyName(const char * str);
+PropertyType strToPropertyType(const char * str);
+Properties strToProperties(const PropertiesData & data);
+
+#endif // PROPERTIES_H
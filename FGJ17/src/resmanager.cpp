@@ -6,14 +6,19 @@
 #include "game.h"
 #include "level.h"
 #include "tmxmap.h"
+#include "cookedlevel.h"
 #include "display.h"
+#include "glyphatlas.h"
 #include "macros.h"
 
 ResManager::ResManager(Game * const game) :
 	m_game(game),
+	m_atlas(nullptr),
 	m_surfaces(),
 	m_textures(),
+	m_regions(),
 	m_fonts(),
+	m_glyphAtlases(),
 	m_music(),
 	m_levels()
 {
@@ -25,6 +30,9 @@ ResManager::~ResManager()
 	for (auto &entry : m_music)
 		Mix_FreeMusic(entry.second);
 
+	for (auto &entry : m_glyphAtlases)
+		delete entry.second;
+
 	for (auto &entry : m_fonts)
 		TTF_CloseFont(entry.second);
 
@@ -34,6 +42,8 @@ ResManager::~ResManager()
 	for (auto &entry : m_textures)
 		SDL_DestroyTexture(entry.second);
 
+	DELETE_SP(m_atlas);
+
 	for (auto & entry : m_levels)
 		delete entry.second;
 }
@@ -57,42 +67,57 @@ SDL_Surface * const ResManager::loadSurface(const std::string & filePath)
 	return m_surfaces[filePath];
 }
 
-SDL_Texture * const ResManager::loadTexture(const std::string & filePath)
+// The region stays valid for the lifetime of the ResManager, packTextures()
+// moves it into an atlas page
+const TextureRegion * const ResManager::loadTexture(const std::string & filePath)
 {
-	if (m_textures.count(filePath) == 0)
+	if (m_regions.count(filePath) == 0)
 	{
-		m_textures[filePath] = SDL_CreateTextureFromSurface(m_game->getDisplay()->getRenderer(), loadSurface(filePath));
+		SDL_Texture * texture = createTexture(filePath);
 
-		if (m_textures[filePath] == NULL)
-		{
-			m_textures.erase(filePath);
-			ERR("ResManager: Error loading texture (" << filePath << " into memory.");
+		if (texture == NULL)
 			return nullptr;
-		}
 
-		LOG("ResManager: Loaded texture (" << filePath << ") into memory.");
+		int32_t w, h;
+		SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+		m_regions[filePath] = TextureRegion{ texture, 0, 0, w, h };
 	}
 
-	return m_textures[filePath];
+	return &m_regions[filePath];
 }
 
 TTF_Font * const ResManager::loadFont(const std::string & filePath, uint32_t fontSize)
 {
-	if (m_fonts.count(filePath) == 0)
+	// Each size of a font is a font of its own
+	const std::string key(filePath + ":" + std::to_string(fontSize));
+
+	if (m_fonts.count(key) == 0)
 	{
-		m_fonts[filePath] = TTF_OpenFont(filePath.c_str(), fontSize);
+		m_fonts[key] = TTF_OpenFont(filePath.c_str(), fontSize);
 
-		if (m_fonts[filePath] == NULL)
+		if (m_fonts[key] == NULL)
 		{
-			m_fonts.erase(filePath);
+			m_fonts.erase(key);
 			ERR("ResManager: Error loading font (" << filePath << " into memory.");
 			return nullptr;
 		}
 
-		LOG("ResManager: Loaded font (" << filePath << ") into memory.");
+		LOG("ResManager: Loaded font (" << filePath << ", size " << fontSize << ") into memory.");
 	}
 
-	return m_fonts[filePath];
+	return m_fonts[key];
+}
+
+GlyphAtlas * const ResManager::loadGlyphAtlas(TTF_Font * const font)
+{
+	if (font == nullptr)
+		return nullptr;
+
+	// Glyphs are rasterized on first use of the atlas
+	if (m_glyphAtlases.count(font) == 0)
+		m_glyphAtlases[font] = new GlyphAtlas(m_game->getDisplay()->getRenderer(), font);
+
+	return m_glyphAtlases[font];
 }
 
 Mix_Music * const ResManager::loadMusic(const std::string & filePath)
@@ -118,7 +143,11 @@ Level * const ResManager::loadLevel(const std::string & filePath, const std::str
 {
 	if (m_levels.count(filePath) == 0)
 	{
-		m_levels[filePath] = new Level(m_game, name, new TmxMap(m_game, filePath));
+		// Prefer the cooked level while it is up to date with the map & the level JSON
+		const std::string cookedFilePath(CookedLevel::toCookedPath(filePath));
+		const bool cooked = CookedLevel::isCurrent(cookedFilePath, { filePath, "./data/levels/" + name + ".json" });
+
+		m_levels[filePath] = new Level(m_game, name, new TmxMap(m_game, (cooked) ? cookedFilePath : filePath));
 
 		if (m_levels[filePath] == NULL)
 		{
@@ -131,4 +160,60 @@ Level * const ResManager::loadLevel(const std::string & filePath, const std::str
 	}
 
 	return m_levels[filePath];
+}
+
+// Packs every texture loaded so far into atlas pages, sprites & images drawn
+// from them follow through their regions. Returns the amount packed.
+size_t ResManager::packTextures(int32_t pageSize)
+{
+	if (m_atlas == nullptr)
+		m_atlas = new TextureAtlas(m_game->getDisplay()->getRenderer(), pageSize);
+
+	// Back to standalone textures first, the previous pages are dropped
+	std::vector<TextureAtlasEntry> entries;
+	for (auto & entry : m_regions)
+	{
+		SDL_Texture * texture = createTexture(entry.first);
+
+		if (texture == NULL)
+			continue;
+
+		entry.second = TextureRegion{ texture, 0, 0, entry.second.w, entry.second.h };
+		entries.push_back(TextureAtlasEntry{ m_surfaces[entry.first], &entry.second });
+	}
+
+	const size_t n_packed = m_atlas->pack(entries);
+
+	// Standalone copies of packed textures are no longer drawn from
+	for (auto & entry : m_regions)
+	{
+		if (m_atlas->contains(entry.second.texture) && m_textures.count(entry.first) != 0)
+		{
+			SDL_DestroyTexture(m_textures[entry.first]);
+			m_textures.erase(entry.first);
+		}
+	}
+
+	LOG("ResManager: Packed " << n_packed << "/" << m_regions.size() << " textures into " << m_atlas->getPageCount() << " atlas pages.");
+
+	return n_packed;
+}
+
+SDL_Texture * const ResManager::createTexture(const std::string & filePath)
+{
+	if (m_textures.count(filePath) == 0)
+	{
+		m_textures[filePath] = SDL_CreateTextureFromSurface(m_game->getDisplay()->getRenderer(), loadSurface(filePath));
+
+		if (m_textures[filePath] == NULL)
+		{
+			m_textures.erase(filePath);
+			ERR("ResManager: Error loading texture (" << filePath << " into memory.");
+			return nullptr;
+		}
+
+		LOG("ResManager: Loaded texture (" << filePath << ") into memory.");
+	}
+
+	return m_textures[filePath];
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include "textureatlas.h"
 
 typedef struct SDL_Surface SDL_Surface;
 typedef struct SDL_Texture SDL_Texture;
@@ -10,6 +11,7 @@ typedef struct _TTF_Font TTF_Font;
 typedef struct _Mix_Music Mix_Music;
 class Game;
 class Level;
+class GlyphAtlas;
 
 class ResManager
 {
@@ -17,15 +19,22 @@ public:
 	ResManager(Game * const game);
 	~ResManager();
 	SDL_Surface * const loadSurface(const std::string & filePath);
-	SDL_Texture * const loadTexture(const std::string & filePath);
+	const TextureRegion * const loadTexture(const std::string & filePath);
 	TTF_Font * const loadFont(const std::string & filePath, uint32_t fontSize = 16);
+	GlyphAtlas * const loadGlyphAtlas(TTF_Font * const font);
 	Mix_Music * const loadMusic(const std::string & filePath);
 	Level * const loadLevel(const std::string & filePath, const std::string & name);
+	size_t packTextures(int32_t pageSize);
 private:
+	SDL_Texture * const createTexture(const std::string & filePath);
+
 	Game * const m_game;
+	TextureAtlas * m_atlas;
 	std::map<std::string, SDL_Surface *> m_surfaces;
 	std::map<std::string, SDL_Texture *> m_textures;
+	std::map<std::string, TextureRegion> m_regions;
 	std::map<std::string, TTF_Font *> m_fonts;
+	std::map<TTF_Font *, GlyphAtlas *> m_glyphAtlases;
 	std::map<std::string, Mix_Music *> m_music;
 	std::map<std::string, Level *> m_levels;
 };
@@ -0,0 +1,68 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <mutex>
+#include <utility>
+
+// Hands the latest state from one producer thread to one consumer thread.
+// The producer fills back() and publish()es it, the consumer acquire()s the
+// newest published state. Three slots, so neither side ever waits for the
+// other to finish with a slot, only for the index swap itself.
+template<typename T>
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer() :
+		m_slots(),
+		m_back(0),
+		m_ready(1),
+		m_front(2),
+		m_fresh(false),
+		m_mutex()
+	{
+
+	}
+
+	// Slot owned by the producer until the next publish()
+	T & back()
+	{
+		return m_slots[m_back];
+	}
+
+	void publish()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::swap(m_back, m_ready);
+		m_fresh = true;
+	}
+
+	// Newest published state, valid until the next acquire()
+	const T & acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_fresh)
+		{
+			std::swap(m_front, m_ready);
+			m_fresh = false;
+		}
+
+		return m_slots[m_front];
+	}
+
+	// State returned by the last acquire()
+	const T & front() const
+	{
+		return m_slots[m_front];
+	}
+
+private:
+	T m_slots[3];
+	int m_back;
+	int m_ready;
+	int m_front;
+	bool m_fresh;
+	std::mutex m_mutex;
+};
+
+#endif // SNAPSHOTBUFFER_H
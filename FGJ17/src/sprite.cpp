@@ -4,7 +4,7 @@
 #include "display.h"
 #include "resmanager.h"
 
-Sprite::Sprite(SDL_Texture * sprSheet, int32_t srcX, int32_t srcY, int32_t srcW, int32_t srcH) :
+Sprite::Sprite(const TextureRegion * sprSheet, int32_t srcX, int32_t srcY, int32_t srcW, int32_t srcH) :
 	m_sprSheet(sprSheet),
 	m_sprAnimFrames(),
 	m_sprAnimRepeat(false),
@@ -17,7 +17,7 @@ Sprite::Sprite(SDL_Texture * sprSheet, int32_t srcX, int32_t srcY, int32_t srcW,
 	m_sprAnimFrames.push_back(srcRect);
 }
 
-Sprite::Sprite(SDL_Texture * sprSheet, std::vector<SprAnimFrame> sprAnimFrames, bool sprAnimRepeat, int32_t sprAnimRate) :
+Sprite::Sprite(const TextureRegion * sprSheet, std::vector<SprAnimFrame> sprAnimFrames, bool sprAnimRepeat, int32_t sprAnimRate) :
 	m_sprSheet(sprSheet),
 	m_sprAnimFrames(),
 	m_sprAnimRepeat(sprAnimRepeat),
@@ -43,7 +43,19 @@ void Sprite::update(double t, double dt)
 
 void Sprite::render(Display * const display, vec2 position)
 {
-	SDL_Rect sourceRect = m_sprAnimFrames[m_sprAnimFrame];
+	render(display, position, m_sprAnimFrame);
+}
+
+// Draws the given animation frame, leaving the animation state untouched
+void Sprite::render(Display * const display, vec2 position, int32_t frame) const
+{
+	if (m_sprSheet == nullptr)
+		return;
+
+	// Frames are relative to the sheet, wherever it was packed
+	SDL_Rect sourceRect = m_sprAnimFrames[frame];
+	sourceRect.x += m_sprSheet->x;
+	sourceRect.y += m_sprSheet->y;
 	SDL_Rect destinationRect = {
 		static_cast<int32_t>(std::round(position.x)),
 		static_cast<int32_t>(std::round(position.y)),
@@ -51,10 +63,10 @@ void Sprite::render(Display * const display, vec2 position)
 		sourceRect.h
 	};
 
-	display->drawImage(m_sprSheet, &sourceRect, &destinationRect, position, true);
+	display->drawImage(m_sprSheet->texture, &sourceRect, &destinationRect, true);
 }
 
-void Sprite::renderOutline(Display * const display, vec2 position)
+void Sprite::renderOutline(Display * const display, vec2 position) const
 {
 	display->drawRectangle(position, vec2(position.x + m_sprAnimFrames[m_sprAnimFrame].w, position.y + m_sprAnimFrames[m_sprAnimFrame].h));
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <cstdint>
 #include "vec2.h"
+#include "textureatlas.h"
 
 class Display;
 
@@ -29,11 +30,12 @@ struct SprAnimFrame
 class Sprite
 {
 public:
-	Sprite(SDL_Texture * sprSheet, int32_t srcX, int32_t srcY, int32_t srcW, int32_t srcH);
-	Sprite(SDL_Texture * sprSheet, std::vector<SprAnimFrame> sprAnimFrames, bool sprAnimRepeat, int32_t sprAnimRate);
+	Sprite(const TextureRegion * sprSheet, int32_t srcX, int32_t srcY, int32_t srcW, int32_t srcH);
+	Sprite(const TextureRegion * sprSheet, std::vector<SprAnimFrame> sprAnimFrames, bool sprAnimRepeat, int32_t sprAnimRate);
 	void update(double t, double dt);
 	void render(Display * const display, vec2 position = vec2(0, 0));
-	void renderOutline(Display * const display, vec2 position = vec2(0, 0));
+	void render(Display * const display, vec2 position, int32_t frame) const;
+	void renderOutline(Display * const display, vec2 position = vec2(0, 0)) const;
 	void setSprAnimTime(double time);
 	void setSprAnimRate(int32_t rate);
 	void setSprAnimFrame(int32_t frame);
@@ -46,7 +48,7 @@ public:
 	int32_t getHeight() const;
 	vec2 getDimensions() const;
 private:
-	SDL_Texture * m_sprSheet;
+	const TextureRegion * m_sprSheet;
 	std::vector<SDL_Rect> m_sprAnimFrames;
 	bool m_sprAnimRepeat;
 	double m_sprAnimTime;
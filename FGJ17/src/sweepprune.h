@@ -0,0 +1,174 @@
+#ifndef SWEEPPRUNE_H
+#define SWEEPPRUNE_H
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include "aabb.h"
+#include "macros.h"
+
+// Stable reference to an item inserted into a SweepAndPrune
+typedef uint32_t SapHandle;
+
+// Sort-and-sweep broadphase on the X axis. Items are kept in a persistent
+// list sorted by their minimum X, refreshed with insertion sort once per
+// update(), which is close to linear when items move a little per tick.
+template<typename T>
+class SweepAndPrune
+{
+	struct SapEntry
+	{
+		float minX;
+		float maxX;
+		float minY;
+		float maxY;
+		T data;
+		SapHandle handle;
+	};
+
+public:
+	SweepAndPrune() :
+		m_entries(),
+		m_positions(),
+		m_freeHandles(),
+		m_maxWidth(0.0f)
+	{
+
+	}
+
+	~SweepAndPrune()
+	{
+
+	}
+
+	SapHandle insertData(const AABB & aabb, T data)
+	{
+		SapHandle handle;
+
+		if (m_freeHandles.empty())
+		{
+			handle = static_cast<SapHandle>(m_positions.size());
+			m_positions.push_back(0);
+		}
+		else
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+
+		// Appended unsorted, the next update() moves it into place
+		m_positions[handle] = static_cast<uint32_t>(m_entries.size());
+		m_entries.push_back(SapEntry{
+			aabb.getMinP().x,
+			aabb.getMaxP().x,
+			aabb.getMinP().y,
+			aabb.getMaxP().y,
+			data,
+			handle
+		});
+
+		return handle;
+	}
+
+	void moveData(const SapHandle handle, const AABB & aabb)
+	{
+		assert(handle < m_positions.size());
+
+		SapEntry & entry = m_entries[m_positions[handle]];
+		entry.minX = aabb.getMinP().x;
+		entry.maxX = aabb.getMaxP().x;
+		entry.minY = aabb.getMinP().y;
+		entry.maxY = aabb.getMaxP().y;
+	}
+
+	void removeData(const SapHandle handle)
+	{
+		assert(handle < m_positions.size());
+
+		// Keep the list sorted, removal is rare compared to movement
+		m_entries.erase(m_entries.begin() + m_positions[handle]);
+		for (uint32_t i = m_positions[handle]; i < m_entries.size(); i++)
+		{
+			m_positions[m_entries[i].handle] = i;
+		}
+
+		m_freeHandles.push_back(handle);
+	}
+
+	// Restores X order after items moved
+	void update()
+	{
+		m_maxWidth = 0.0f;
+
+		for (uint32_t i = 0; i < m_entries.size(); i++)
+		{
+			const SapEntry entry = m_entries[i];
+			uint32_t j = i;
+
+			while (j > 0 && m_entries[j - 1].minX > entry.minX)
+			{
+				m_entries[j] = m_entries[j - 1];
+				m_positions[m_entries[j].handle] = j;
+				j--;
+			}
+
+			m_entries[j] = entry;
+			m_positions[entry.handle] = j;
+			m_maxWidth = std::max(m_maxWidth, entry.maxX - entry.minX);
+		}
+	}
+
+	// Calls visitor(T, T) exactly once for every pair of overlapping items
+	template<typename F>
+	void visitPairs(F && visitor) const
+	{
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			const SapEntry & a = m_entries[i];
+
+			for (size_t j = i + 1; j < m_entries.size() && m_entries[j].minX <= a.maxX; j++)
+			{
+				const SapEntry & b = m_entries[j];
+
+				if (a.minY <= b.maxY && b.minY <= a.maxY)
+					visitor(a.data, b.data);
+			}
+		}
+	}
+
+	// Calls visitor(T) once for every item overlapping the AABB
+	template<typename F>
+	void visitOverlappingData(const AABB & aabb, F && visitor) const
+	{
+		const float minX = aabb.getMinP().x;
+		const float maxX = aabb.getMaxP().x;
+		const float minY = aabb.getMinP().y;
+		const float maxY = aabb.getMaxP().y;
+
+		// No item starting left of this can reach the query
+		auto it = std::lower_bound(m_entries.begin(), m_entries.end(), minX - m_maxWidth, [](const SapEntry & e, float x)
+		{
+			return e.minX < x;
+		});
+
+		for (; it != m_entries.end() && it->minX <= maxX; ++it)
+		{
+			if (it->maxX >= minX && it->minY <= maxY && minY <= it->maxY)
+				visitor(it->data);
+		}
+	}
+
+	size_t size() const
+	{
+		return m_entries.size();
+	}
+
+private:
+	std::vector<SapEntry> m_entries;
+	std::vector<uint32_t> m_positions;
+	std::vector<SapHandle> m_freeHandles;
+	float m_maxWidth;
+};
+
+#endif // SWEEPPRUNE_H
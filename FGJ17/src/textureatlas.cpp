@@ -0,0 +1,140 @@
+#include "textureatlas.h"
+#include <algorithm>
+#include "macros.h"
+
+TextureAtlas::TextureAtlas(SDL_Renderer * const renderer, int32_t pageSize) :
+	m_renderer(renderer),
+	m_pageSize(pageSize),
+	m_pages()
+{
+	// Pages can't be larger than the renderer allows
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(m_renderer, &info) == 0 && info.max_texture_width > 0 && info.max_texture_height > 0)
+		m_pageSize = std::min(m_pageSize, std::min(info.max_texture_width, info.max_texture_height));
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	clear();
+}
+
+// Returns the amount of entries packed, their regions now point into the pages
+size_t TextureAtlas::pack(std::vector<TextureAtlasEntry> entries)
+{
+	const int32_t padding = 1;
+
+	clear();
+
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const TextureAtlasEntry & e)
+	{
+		return e.surface == NULL || e.surface->w > m_pageSize || e.surface->h > m_pageSize;
+	}), entries.end());
+
+	std::sort(entries.begin(), entries.end(), [](const TextureAtlasEntry & a, const TextureAtlasEntry & b)
+	{
+		return (a.surface->h != b.surface->h) ? a.surface->h > b.surface->h : a.surface->w > b.surface->w;
+	});
+
+	// Shelf placement, pages are only as large as their contents
+	std::vector<SDL_Rect> placement(entries.size());
+	std::vector<size_t> page(entries.size());
+	std::vector<SDL_Point> pageSize;
+	int32_t x = 0, y = 0, shelfHeight = 0;
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const int32_t w = entries[i].surface->w;
+		const int32_t h = entries[i].surface->h;
+
+		if (pageSize.empty())
+			pageSize.push_back(SDL_Point{ 0, 0 });
+
+		if (x + w > m_pageSize)
+		{
+			x = 0;
+			y += shelfHeight + padding;
+			shelfHeight = 0;
+		}
+
+		if (y + h > m_pageSize)
+		{
+			pageSize.push_back(SDL_Point{ 0, 0 });
+			x = y = shelfHeight = 0;
+		}
+
+		placement[i] = SDL_Rect{ x, y, w, h };
+		page[i] = pageSize.size() - 1;
+		pageSize.back().x = std::max(pageSize.back().x, x + w);
+		pageSize.back().y = std::max(pageSize.back().y, y + h);
+		x += w + padding;
+		shelfHeight = std::max(shelfHeight, h);
+	}
+
+	for (size_t p = 0; p < pageSize.size(); p++)
+	{
+		SDL_Surface * surface = SDL_CreateRGBSurfaceWithFormat(0, pageSize[p].x, pageSize[p].y, 32, SDL_PIXELFORMAT_RGBA32);
+
+		if (surface == NULL)
+		{
+			ERR("TextureAtlas: SDL_CreateRGBSurfaceWithFormat Error: " << SDL_GetError());
+			clear();
+			return 0;
+		}
+
+		// Copy pixels as is, colour keyed ones stay transparent
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (page[i] != p)
+				continue;
+
+			SDL_Rect destRect = placement[i];
+			SDL_BlendMode blendMode;
+			SDL_GetSurfaceBlendMode(entries[i].surface, &blendMode);
+			SDL_SetSurfaceBlendMode(entries[i].surface, SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(entries[i].surface, NULL, surface, &destRect);
+			SDL_SetSurfaceBlendMode(entries[i].surface, blendMode);
+		}
+
+		SDL_Texture * texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+		SDL_FreeSurface(surface);
+
+		if (texture == NULL)
+		{
+			ERR("TextureAtlas: SDL_CreateTextureFromSurface Error: " << SDL_GetError());
+			clear();
+			return 0;
+		}
+
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		m_pages.push_back(texture);
+
+		LOG("TextureAtlas: Built atlas page " << p << " (" << pageSize[p].x << "x" << pageSize[p].y << ").");
+	}
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		*entries[i].region = TextureRegion{ m_pages[page[i]], placement[i].x, placement[i].y, placement[i].w, placement[i].h };
+	}
+
+	return entries.size();
+}
+
+bool TextureAtlas::contains(SDL_Texture * const texture) const
+{
+	return std::find(m_pages.begin(), m_pages.end(), texture) != m_pages.end();
+}
+
+size_t TextureAtlas::getPageCount() const
+{
+	return m_pages.size();
+}
+
+void TextureAtlas::clear()
+{
+	for (SDL_Texture * t : m_pages)
+	{
+		SDL_DestroyTexture(t);
+	}
+
+	m_pages.clear();
+}
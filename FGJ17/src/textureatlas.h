@@ -0,0 +1,45 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <vector>
+
+// Area of a texture an image lives in. Sprites & images keep a pointer to
+// their region and offset their source rects by it, so packing an image
+// into an atlas moves everything drawn from it along.
+struct TextureRegion
+{
+	SDL_Texture * texture;
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+};
+
+struct TextureAtlasEntry
+{
+	SDL_Surface * surface;
+	TextureRegion * region;
+};
+
+// Packs surfaces into as few pageSize x pageSize textures as it can, tallest
+// first on shelves, 1px apart. Surfaces larger than a page are left alone.
+// Packing again drops the previous pages.
+class TextureAtlas
+{
+public:
+	TextureAtlas(SDL_Renderer * const renderer, int32_t pageSize);
+	~TextureAtlas();
+	size_t pack(std::vector<TextureAtlasEntry> entries);
+	bool contains(SDL_Texture * const texture) const;
+	size_t getPageCount() const;
+private:
+	void clear();
+
+	SDL_Renderer * const m_renderer;
+	int32_t m_pageSize;
+	std::vector<SDL_Texture *> m_pages;
+};
+
+#endif // TEXTUREATLAS_H
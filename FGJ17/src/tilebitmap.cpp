@@ -0,0 +1,102 @@
+#include "tilebitmap.h"
+#include <cmath>
+#include <algorithm>
+#include "tmxmap.h"
+#include "tile.h"
+
+TileBitmap::TileBitmap(const TmxMapData & mapData) :
+	m_width(static_cast<int32_t>(mapData.width)),
+	m_height(static_cast<int32_t>(mapData.height)),
+	m_tileWidth(static_cast<int32_t>(mapData.tilewidth)),
+	m_tileHeight(static_cast<int32_t>(mapData.tileheight)),
+	m_stride((m_width + 63) >> 6),
+	m_bits(static_cast<size_t>(TC_COUNT) * m_height * m_stride, 0)
+{
+	// Rasterize the classes of every tile on every layer
+	for (auto & l : mapData.layer)
+	{
+		l.visitTiles([&](const Tile & t)
+		{
+			const uint32_t classes = tileToClasses(t);
+			const int32_t tx = static_cast<int32_t>(t.getPosition().x) / m_tileWidth;
+			const int32_t ty = static_cast<int32_t>(t.getPosition().y) / m_tileHeight;
+
+			for (uint8_t c = 0; c < TC_COUNT; c++)
+			{
+				if (classes & (1 << c))
+					set(tx, ty, static_cast<TileClass>(c));
+			}
+		});
+	}
+}
+
+void TileBitmap::set(int32_t tx, int32_t ty, TileClass c)
+{
+	if (tx < 0 || ty < 0 || tx >= m_width || ty >= m_height)
+		return;
+
+	m_bits[(static_cast<size_t>(c) * m_height + ty) * m_stride + (tx >> 6)] |= 1ull << (tx & 63);
+}
+
+void TileBitmap::clear(int32_t tx, int32_t ty, TileClass c)
+{
+	if (tx < 0 || ty < 0 || tx >= m_width || ty >= m_height)
+		return;
+
+	m_bits[(static_cast<size_t>(c) * m_height + ty) * m_stride + (tx >> 6)] &= ~(1ull << (tx & 63));
+}
+
+bool TileBitmap::test(int32_t tx, int32_t ty, TileClass c) const
+{
+	if (tx < 0 || ty < 0 || tx >= m_width || ty >= m_height)
+		return false;
+
+	return (m_bits[(static_cast<size_t>(c) * m_height + ty) * m_stride + (tx >> 6)] >> (tx & 63)) & 1;
+}
+
+uint32_t TileBitmap::getClasses(const AABB & aabb) const
+{
+	uint32_t classes = 0;
+
+	for (uint8_t c = 0; c < TC_COUNT; c++)
+	{
+		visit(aabb, static_cast<TileClass>(c), [&](int32_t, int32_t)
+		{
+			classes |= 1 << c;
+		});
+	}
+
+	return classes;
+}
+
+AABB TileBitmap::getTileAABB(int32_t tx, int32_t ty) const
+{
+	const vec2 minP(static_cast<float>(tx * m_tileWidth), static_cast<float>(ty * m_tileHeight));
+	return AABB(minP, minP + vec2(static_cast<float>(m_tileWidth), static_cast<float>(m_tileHeight)));
+}
+
+int32_t TileBitmap::getWidth() const
+{
+	return m_width;
+}
+
+int32_t TileBitmap::getHeight() const
+{
+	return m_height;
+}
+
+uint32_t TileBitmap::tileToClasses(const Tile & tile)
+{
+	return tile.getProperties().type & ((1u << TC_COUNT) - 1);
+}
+
+bool TileBitmap::tileSpan(const AABB & aabb, int32_t & tx0, int32_t & ty0, int32_t & tx1, int32_t & ty1) const
+{
+	// Touching edges count as contact, like the AABB collision tests
+	tx0 = std::max(static_cast<int32_t>(std::ceil(aabb.getMinP().x / m_tileWidth)) - 1, 0);
+	ty0 = std::max(static_cast<int32_t>(std::ceil(aabb.getMinP().y / m_tileHeight)) - 1, 0);
+	tx1 = std::min(static_cast<int32_t>(std::floor(aabb.getMaxP().x / m_tileWidth)), m_width - 1);
+	ty1 = std::min(static_cast<int32_t>(std::floor(aabb.getMaxP().y / m_tileHeight)), m_height - 1);
+
+	return tx0 <= tx1 && ty0 <= ty1;
+}
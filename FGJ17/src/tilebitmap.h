@@ -0,0 +1,86 @@
+#ifndef TILEBITMAP_H
+#define TILEBITMAP_H
+
+#include <cstdint>
+#include <vector>
+#include "tools.h"
+#include "aabb.h"
+#include "properties.h"
+
+struct TmxMapData;
+class Tile;
+
+// Tile classes share their bit positions with PropertyType
+enum TileClass : uint8_t
+{
+	TC_SOLID = PT_SOLID,
+	TC_TRIGGER = PT_TRIGGER,
+	TC_GATE = PT_GATE,
+	TC_BUTTON = PT_BUTTON,
+	TC_COMPUTER = PT_COMPUTER,
+	TC_COUNT = PT_COMPUTER + 1
+};
+
+// Packed per-level bitmap of tile classes, one bit plane per class, rows of
+// 64-bit words indexed by tile x/y. Tile (x, y) covers the world rectangle
+// [x * tileWidth, (x + 1) * tileWidth] x [y * tileHeight, (y + 1) * tileHeight].
+class TileBitmap
+{
+public:
+	TileBitmap(const TmxMapData & mapData);
+	void set(int32_t tx, int32_t ty, TileClass c);
+	void clear(int32_t tx, int32_t ty, TileClass c);
+	bool test(int32_t tx, int32_t ty, TileClass c) const;
+	uint32_t getClasses(const AABB & aabb) const;
+	AABB getTileAABB(int32_t tx, int32_t ty) const;
+	int32_t getWidth() const;
+	int32_t getHeight() const;
+
+	static uint32_t tileToClasses(const Tile & tile);
+
+	// Calls visitor(tx, ty) for every tile of class c touching the AABB
+	template<typename F>
+	void visit(const AABB & aabb, TileClass c, F && visitor) const
+	{
+		int32_t tx0, ty0, tx1, ty1;
+		if (!tileSpan(aabb, tx0, ty0, tx1, ty1))
+			return;
+
+		for (int32_t ty = ty0; ty <= ty1; ty++)
+		{
+			const uint64_t * row = &m_bits[(static_cast<size_t>(c) * m_height + ty) * m_stride];
+
+			for (int32_t w = tx0 >> 6; w <= tx1 >> 6; w++)
+			{
+				uint64_t bits = row[w] & spanMask(w, tx0, tx1);
+
+				while (bits != 0)
+				{
+					visitor((w << 6) + static_cast<int32_t>(ctz64(bits)), ty);
+					bits &= bits - 1;
+				}
+			}
+		}
+	}
+private:
+	bool tileSpan(const AABB & aabb, int32_t & tx0, int32_t & ty0, int32_t & tx1, int32_t & ty1) const;
+
+	// Bits of word w that lie within columns [tx0, tx1]
+	static uint64_t spanMask(int32_t w, int32_t tx0, int32_t tx1)
+	{
+		const int32_t lo = tx0 - (w << 6);
+		const int32_t hi = tx1 - (w << 6);
+		const uint64_t loMask = (lo <= 0) ? ~0ull : (~0ull << lo);
+		const uint64_t hiMask = (hi >= 63) ? ~0ull : ((1ull << (hi + 1)) - 1);
+		return loMask & hiMask;
+	}
+
+	int32_t m_width;
+	int32_t m_height;
+	int32_t m_tileWidth;
+	int32_t m_tileHeight;
+	int32_t m_stride;
+	std::vector<uint64_t> m_bits;
+};
+
+#endif // TILEBITMAP_H
@@ -0,0 +1,176 @@
+#include "tilechunkcache.h"
+#include <SDL.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "macros.h"
+#include "display.h"
+#include "tmxmap.h"
+
+TileChunkCache::TileChunkCache(
+	Display * const display,
+	TmxMapData & mapData,
+	int32_t chunkTiles,
+	size_t capacity
+) :
+	m_display(display),
+	m_mapData(mapData),
+	m_chunkTiles(chunkTiles),
+	m_chunkWidth(chunkTiles * mapData.tilewidth),
+	m_chunkHeight(chunkTiles * mapData.tileheight),
+	m_chunksW((mapData.width + chunkTiles - 1) / chunkTiles),
+	m_chunksH((mapData.height + chunkTiles - 1) / chunkTiles),
+	m_capacity(std::max<size_t>(capacity, 1)),
+	m_chunks(),
+	m_lookup()
+{
+
+}
+
+TileChunkCache::~TileChunkCache()
+{
+	invalidateAll();
+}
+
+void TileChunkCache::render(const AABB & view, TileLayer layer)
+{
+	int32_t cx0, cy0, cx1, cy1;
+	if (!chunkSpan(view, cx0, cy0, cx1, cy1))
+		return;
+
+	for (int32_t cy = cy0; cy <= cy1; cy++)
+	{
+		for (int32_t cx = cx0; cx <= cx1; cx++)
+		{
+			const TileChunk & chunk = fetch(cx, cy, layer);
+
+			// Chunks without tiles of this pass have no texture
+			if (chunk.texture == NULL)
+				continue;
+
+			SDL_Rect sourceRect = { 0, 0, m_chunkWidth, m_chunkHeight };
+			SDL_Rect destinationRect = { cx * m_chunkWidth, cy * m_chunkHeight, m_chunkWidth, m_chunkHeight };
+
+			m_display->drawImage(chunk.texture, &sourceRect, &destinationRect, true);
+		}
+	}
+}
+
+// Drops every chunk touching the AABB, they are baked again when next seen
+void TileChunkCache::invalidate(const AABB & aabb)
+{
+	int32_t cx0, cy0, cx1, cy1;
+	if (!chunkSpan(aabb, cx0, cy0, cx1, cy1))
+		return;
+
+	for (int32_t cy = cy0; cy <= cy1; cy++)
+	{
+		for (int32_t cx = cx0; cx <= cx1; cx++)
+		{
+			for (uint8_t l = TL_BACKGROUND; l <= TL_FOREGROUND; l++)
+			{
+				auto it = m_lookup.find(chunkKey(cx, cy, static_cast<TileLayer>(l)));
+
+				if (it != m_lookup.end())
+					drop(it->second);
+			}
+		}
+	}
+}
+
+void TileChunkCache::invalidateAll()
+{
+	while (!m_chunks.empty())
+	{
+		drop(m_chunks.begin());
+	}
+}
+
+size_t TileChunkCache::size() const
+{
+	return m_chunks.size();
+}
+
+TileChunk & TileChunkCache::fetch(int32_t cx, int32_t cy, TileLayer layer)
+{
+	auto it = m_lookup.find(chunkKey(cx, cy, layer));
+
+	// Most recently used chunks are kept at the front
+	if (it != m_lookup.end())
+	{
+		m_chunks.splice(m_chunks.begin(), m_chunks, it->second);
+		return m_chunks.front();
+	}
+
+	if (m_chunks.size() >= m_capacity)
+		drop(std::prev(m_chunks.end()));
+
+	m_chunks.push_front(TileChunk{ cx, cy, layer, NULL });
+	m_lookup[chunkKey(cx, cy, layer)] = m_chunks.begin();
+	bake(m_chunks.front());
+
+	return m_chunks.front();
+}
+
+void TileChunkCache::bake(TileChunk & chunk)
+{
+	const AABB aabb = chunkAABB(chunk.cx, chunk.cy);
+	const int32_t tx0 = chunk.cx * m_chunkTiles;
+	const int32_t ty0 = chunk.cy * m_chunkTiles;
+	std::vector<Tile> tiles;
+
+	// Layers of this pass in map order
+	for (TmxLayerData & l : m_mapData.layer)
+	{
+		if ((l.layer == TL_BACKGROUND) != (chunk.layer == TL_BACKGROUND))
+			continue;
+
+		l.visitTiles(tx0, ty0, tx0 + m_chunkTiles - 1, ty0 + m_chunkTiles - 1, [&](const Tile & t)
+		{
+			tiles.push_back(t);
+		});
+	}
+
+	if (tiles.empty())
+		return;
+
+	chunk.texture = m_display->createRenderTarget(m_chunkWidth, m_chunkHeight);
+	if (chunk.texture == NULL)
+		return;
+
+	m_display->setRenderTarget(chunk.texture, aabb.getMinP());
+	for (const Tile & t : tiles)
+	{
+		t.render(m_display);
+	}
+	m_display->setRenderTarget(NULL);
+}
+
+void TileChunkCache::drop(std::list<TileChunk>::iterator it)
+{
+	// The texture may still be queued for drawing
+	if (it->texture != NULL)
+	{
+		m_display->flush();
+		SDL_DestroyTexture(it->texture);
+	}
+
+	m_lookup.erase(chunkKey(it->cx, it->cy, it->layer));
+	m_chunks.erase(it);
+}
+
+AABB TileChunkCache::chunkAABB(int32_t cx, int32_t cy) const
+{
+	const vec2 minP(static_cast<float>(cx * m_chunkWidth), static_cast<float>(cy * m_chunkHeight));
+	return AABB(minP, minP + vec2(static_cast<float>(m_chunkWidth), static_cast<float>(m_chunkHeight)));
+}
+
+bool TileChunkCache::chunkSpan(const AABB & aabb, int32_t & cx0, int32_t & cy0, int32_t & cx1, int32_t & cy1) const
+{
+	cx0 = std::max(static_cast<int32_t>(std::floor(aabb.getMinP().x / m_chunkWidth)), 0);
+	cy0 = std::max(static_cast<int32_t>(std::floor(aabb.getMinP().y / m_chunkHeight)), 0);
+	cx1 = std::min(static_cast<int32_t>(std::floor(aabb.getMaxP().x / m_chunkWidth)), m_chunksW - 1);
+	cy1 = std::min(static_cast<int32_t>(std::floor(aabb.getMaxP().y / m_chunkHeight)), m_chunksH - 1);
+
+	return cx0 <= cx1 && cy0 <= cy1;
+}
@@ -0,0 +1,65 @@
+#ifndef TILECHUNKCACHE_H
+#define TILECHUNKCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include "aabb.h"
+#include "tile.h"
+
+typedef struct SDL_Texture SDL_Texture;
+class Display;
+struct TmxMapData;
+
+struct TileChunk
+{
+	int32_t cx;
+	int32_t cy;
+	TileLayer layer;
+	SDL_Texture * texture;
+};
+
+// Static tiles pre-rendered into render target textures, one per chunk of
+// chunkTiles x chunkTiles tiles and per pass. Background holds the
+// TL_BACKGROUND tiles, foreground everything else, like Level::render.
+// Chunks are baked on first use and the least recently used ones are
+// dropped once the cache holds more than capacity chunks.
+class TileChunkCache
+{
+public:
+	TileChunkCache(
+		Display * const display,
+		TmxMapData & mapData,
+		int32_t chunkTiles,
+		size_t capacity
+	);
+	~TileChunkCache();
+	void render(const AABB & view, TileLayer layer);
+	void invalidate(const AABB & aabb);
+	void invalidateAll();
+	size_t size() const;
+private:
+	TileChunk & fetch(int32_t cx, int32_t cy, TileLayer layer);
+	void bake(TileChunk & chunk);
+	void drop(std::list<TileChunk>::iterator it);
+	AABB chunkAABB(int32_t cx, int32_t cy) const;
+	bool chunkSpan(const AABB & aabb, int32_t & cx0, int32_t & cy0, int32_t & cx1, int32_t & cy1) const;
+
+	static uint64_t chunkKey(int32_t cx, int32_t cy, TileLayer layer)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | (static_cast<uint32_t>(cy) << 1) | layer;
+	}
+
+	Display * const m_display;
+	TmxMapData & m_mapData;
+	int32_t m_chunkTiles;
+	int32_t m_chunkWidth;
+	int32_t m_chunkHeight;
+	int32_t m_chunksW;
+	int32_t m_chunksH;
+	size_t m_capacity;
+	std::list<TileChunk> m_chunks;
+	std::unordered_map<uint64_t, std::list<TileChunk>::iterator> m_lookup;
+};
+
+#endif // TILECHUNKCACHE_H
@@ -0,0 +1,626 @@
+#include "tmxdecode.h"
+#include <cstring>
+#include "macros.h"
+#include "tools.h"
+
+// ---------------------------------------------------------------------------
+// CSV
+// ---------------------------------------------------------------------------
+bool decodeCsvGids(const char * str, size_t length, std::vector<uint32_t> & gids)
+{
+	const char * end = str + length;
+	uint32_t gid = 0;
+	bool digits = false;
+
+	for (const char * c = str; ; c++)
+	{
+		if (c == end)
+		{
+			if (digits)
+				gids.push_back(gid & TMX_GID_MASK);
+
+			return true;
+		}
+
+		if (*c >= '0' && *c <= '9')
+		{
+			gid = gid * 10 + static_cast<uint32_t>(*c - '0');
+			digits = true;
+		}
+		else if (*c == ',')
+		{
+			if (!digits)
+				return false;
+
+			gids.push_back(gid & TMX_GID_MASK);
+			gid = 0;
+			digits = false;
+		}
+		else if (*c != ' ' && *c != '\t' && *c != '\r' && *c != '\n')
+		{
+			return false;
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Base64
+// Whole groups of four characters are decoded without any per character
+// checks beyond the table lookup, whitespace & padding take the slow path.
+// ---------------------------------------------------------------------------
+static const uint8_t B64_INVALID = 0x40;
+static const uint8_t B64_SPACE = 0x80;
+
+struct Base64Table
+{
+	uint8_t values[256];
+
+	Base64Table()
+	{
+		const char * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		memset(values, B64_INVALID, sizeof(values));
+		for (uint8_t i = 0; i < 64; i++)
+			values[static_cast<uint8_t>(alphabet[i])] = i;
+
+		values[' '] = values['\t'] = values['\r'] = values['\n'] = B64_SPACE;
+	}
+};
+
+static const Base64Table B64_TABLE;
+
+bool decodeBase64(const char * str, size_t length, std::vector<uint8_t> & data)
+{
+	const uint8_t * c = reinterpret_cast<const uint8_t *>(str);
+	const uint8_t * end = c + length;
+	const uint8_t * values = B64_TABLE.values;
+	uint32_t group = 0;
+	uint32_t n_group = 0;
+	uint32_t n_padding = 0;
+
+	data.reserve(data.size() + (end - c) / 4 * 3);
+
+	while (c < end)
+	{
+		// Fast path, four valid characters at group boundary
+		if (n_group == 0 && n_padding == 0 && end - c >= 4)
+		{
+			const uint32_t v = (values[c[0]] << 18) | (values[c[1]] << 12) | (values[c[2]] << 6) | values[c[3]];
+
+			if (((values[c[0]] | values[c[1]] | values[c[2]] | values[c[3]]) & (B64_INVALID | B64_SPACE)) == 0)
+			{
+				data.push_back(static_cast<uint8_t>(v >> 16));
+				data.push_back(static_cast<uint8_t>(v >> 8));
+				data.push_back(static_cast<uint8_t>(v));
+				c += 4;
+				continue;
+			}
+		}
+
+		const uint8_t value = values[*c++];
+
+		if (value == B64_SPACE)
+			continue;
+
+		// Padding ends the data, only whitespace may follow
+		if (c[-1] == '=')
+		{
+			n_padding++;
+			continue;
+		}
+
+		if (value == B64_INVALID || n_padding != 0)
+			return false;
+
+		group = (group << 6) | value;
+		if (++n_group == 4)
+		{
+			data.push_back(static_cast<uint8_t>(group >> 16));
+			data.push_back(static_cast<uint8_t>(group >> 8));
+			data.push_back(static_cast<uint8_t>(group));
+			group = 0;
+			n_group = 0;
+		}
+	}
+
+	// Trailing partial group, padded or not
+	if (n_group == 1 || n_group + n_padding > 4)
+		return false;
+
+	if (n_group == 2)
+	{
+		data.push_back(static_cast<uint8_t>(group >> 4));
+	}
+	else if (n_group == 3)
+	{
+		data.push_back(static_cast<uint8_t>(group >> 10));
+		data.push_back(static_cast<uint8_t>(group >> 2));
+	}
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Inflate
+// Plain DEFLATE (RFC 1951) decoder with canonical Huffman decoding a bit at
+// a time. Tile layers are small, simplicity beats table driven decoding.
+// ---------------------------------------------------------------------------
+struct InflateHuffman
+{
+	uint16_t count[16];
+	uint16_t symbol[288];
+};
+
+struct InflateState
+{
+	const uint8_t * src;
+	size_t size;
+	size_t pos;
+	uint32_t bitBuffer;
+	uint32_t bitCount;
+	bool error;
+	std::vector<uint8_t> & data;
+	size_t start;
+};
+
+static const uint16_t INFLATE_LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t INFLATE_LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t INFLATE_DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t INFLATE_DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t INFLATE_CODE_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static uint32_t inflateBits(InflateState & s, uint32_t n)
+{
+	while (s.bitCount < n)
+	{
+		if (s.pos == s.size)
+		{
+			s.error = true;
+			return 0;
+		}
+
+		s.bitBuffer |= static_cast<uint32_t>(s.src[s.pos++]) << s.bitCount;
+		s.bitCount += 8;
+	}
+
+	const uint32_t v = s.bitBuffer & ((1u << n) - 1);
+	s.bitBuffer >>= n;
+	s.bitCount -= n;
+
+	return v;
+}
+
+// Returns false for over subscribed code lengths
+static bool inflateBuild(InflateHuffman & h, const uint8_t * lengths, uint32_t n)
+{
+	uint16_t offsets[16];
+
+	memset(h.count, 0, sizeof(h.count));
+	for (uint32_t i = 0; i < n; i++)
+		h.count[lengths[i]]++;
+
+	int32_t left = 1;
+	for (uint32_t len = 1; len < 16; len++)
+	{
+		left = (left << 1) - h.count[len];
+		if (left < 0)
+			return false;
+	}
+
+	offsets[1] = 0;
+	for (uint32_t len = 1; len < 15; len++)
+		offsets[len + 1] = offsets[len] + h.count[len];
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		if (lengths[i] != 0)
+			h.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+	}
+
+	return true;
+}
+
+static int32_t inflateDecode(InflateState & s, const InflateHuffman & h)
+{
+	int32_t code = 0, first = 0, index = 0;
+
+	for (uint32_t len = 1; len < 16; len++)
+	{
+		code |= static_cast<int32_t>(inflateBits(s, 1));
+		if (s.error)
+			return -1;
+
+		const int32_t count = h.count[len];
+		if (code - count < first)
+			return h.symbol[index + (code - first)];
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+static bool inflateCodes(InflateState & s, const InflateHuffman & lencode, const InflateHuffman & distcode)
+{
+	for (;;)
+	{
+		int32_t symbol = inflateDecode(s, lencode);
+
+		if (symbol < 0)
+			return false;
+
+		if (symbol < 256)
+		{
+			s.data.push_back(static_cast<uint8_t>(symbol));
+			continue;
+		}
+
+		if (symbol == 256)
+			return true;
+
+		symbol -= 257;
+		if (symbol >= 29)
+			return false;
+
+		const uint32_t length = INFLATE_LENGTH_BASE[symbol] + inflateBits(s, INFLATE_LENGTH_EXTRA[symbol]);
+
+		symbol = inflateDecode(s, distcode);
+		if (symbol < 0 || symbol >= 30)
+			return false;
+
+		const uint32_t dist = INFLATE_DIST_BASE[symbol] + inflateBits(s, INFLATE_DIST_EXTRA[symbol]);
+		if (s.error || dist > s.data.size() - s.start)
+			return false;
+
+		// Byte by byte, the copy may overlap its own output
+		size_t from = s.data.size() - dist;
+		for (uint32_t i = 0; i < length; i++)
+			s.data.push_back(s.data[from++]);
+	}
+}
+
+static bool inflateStored(InflateState & s)
+{
+	s.bitBuffer = 0;
+	s.bitCount = 0;
+
+	if (s.size - s.pos < 4)
+		return false;
+
+	const uint32_t len = s.src[s.pos] | (s.src[s.pos + 1] << 8);
+	const uint32_t nlen = s.src[s.pos + 2] | (s.src[s.pos + 3] << 8);
+	s.pos += 4;
+
+	if (len != (~nlen & 0xFFFF) || s.size - s.pos < len)
+		return false;
+
+	s.data.insert(s.data.end(), s.src + s.pos, s.src + s.pos + len);
+	s.pos += len;
+
+	return true;
+}
+
+static bool inflateFixed(InflateState & s)
+{
+	InflateHuffman lencode, distcode;
+	uint8_t lengths[288];
+
+	memset(lengths, 8, 144);
+	memset(lengths + 144, 9, 112);
+	memset(lengths + 256, 7, 24);
+	memset(lengths + 280, 8, 8);
+	inflateBuild(lencode, lengths, 288);
+
+	memset(lengths, 5, 30);
+	inflateBuild(distcode, lengths, 30);
+
+	return inflateCodes(s, lencode, distcode);
+}
+
+static bool inflateDynamic(InflateState & s)
+{
+	InflateHuffman lencode, distcode;
+	uint8_t lengths[320];
+
+	const uint32_t n_len = inflateBits(s, 5) + 257;
+	const uint32_t n_dist = inflateBits(s, 5) + 1;
+	const uint32_t n_code = inflateBits(s, 4) + 4;
+
+	if (s.error || n_len > 286 || n_dist > 30)
+		return false;
+
+	// Code length code lengths
+	memset(lengths, 0, 19);
+	for (uint32_t i = 0; i < n_code; i++)
+		lengths[INFLATE_CODE_ORDER[i]] = static_cast<uint8_t>(inflateBits(s, 3));
+
+	if (s.error || !inflateBuild(lencode, lengths, 19))
+		return false;
+
+	// Literal/length & distance code lengths, run length coded
+	uint32_t index = 0;
+	while (index < n_len + n_dist)
+	{
+		int32_t symbol = inflateDecode(s, lencode);
+
+		if (symbol < 0)
+			return false;
+
+		if (symbol < 16)
+		{
+			lengths[index++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+
+		uint8_t length = 0;
+		uint32_t repeat = 0;
+
+		if (symbol == 16)
+		{
+			if (index == 0)
+				return false;
+
+			length = lengths[index - 1];
+			repeat = 3 + inflateBits(s, 2);
+		}
+		else if (symbol == 17)
+		{
+			repeat = 3 + inflateBits(s, 3);
+		}
+		else
+		{
+			repeat = 11 + inflateBits(s, 7);
+		}
+
+		if (s.error || index + repeat > n_len + n_dist)
+			return false;
+
+		while (repeat--)
+			lengths[index++] = length;
+	}
+
+	// End of block code is mandatory
+	if (lengths[256] == 0)
+		return false;
+
+	if (!inflateBuild(lencode, lengths, n_len) || !inflateBuild(distcode, lengths + n_len, n_dist))
+		return false;
+
+	return inflateCodes(s, lencode, distcode);
+}
+
+static bool inflateRaw(InflateState & s)
+{
+	uint32_t last = 0;
+
+	while (last == 0)
+	{
+		last = inflateBits(s, 1);
+		const uint32_t type = inflateBits(s, 2);
+
+		if (s.error)
+			return false;
+
+		bool ok = false;
+		switch (type)
+		{
+		case 0:
+			ok = inflateStored(s);
+			break;
+		case 1:
+			ok = inflateFixed(s);
+			break;
+		case 2:
+			ok = inflateDynamic(s);
+			break;
+		default:
+			break;
+		}
+
+		if (!ok || s.error)
+			return false;
+	}
+
+	// Trailers start at the next byte
+	s.bitBuffer = 0;
+	s.bitCount = 0;
+
+	return true;
+}
+
+static uint32_t adler32(const uint8_t * data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+struct Crc32Table
+{
+	uint32_t values[256];
+
+	Crc32Table()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (uint32_t k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+			values[i] = c;
+		}
+	}
+};
+
+static const Crc32Table CRC32_TABLE;
+
+static uint32_t crc32(const uint8_t * data, size_t size)
+{
+	uint32_t c = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < size; i++)
+		c = CRC32_TABLE.values[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+
+	return c ^ 0xFFFFFFFF;
+}
+
+bool inflateData(const uint8_t * src, size_t size, TmxCompression compression, std::vector<uint8_t> & data)
+{
+	const size_t start = data.size();
+	InflateState s = { src, size, 0, 0, 0, false, data, start };
+
+	if (compression == TMC_ZLIB)
+	{
+		// CMF & FLG, deflate without a preset dictionary
+		if (size < 6 || (src[0] & 0x0F) != 8 || ((src[0] << 8) | src[1]) % 31 != 0 || (src[1] & 0x20) != 0)
+			return false;
+
+		s.pos = 2;
+		if (!inflateRaw(s) || s.size - s.pos < 4)
+			return false;
+
+		const uint32_t check = (src[s.pos] << 24) | (src[s.pos + 1] << 16) | (src[s.pos + 2] << 8) | src[s.pos + 3];
+		return check == adler32(data.data() + start, data.size() - start);
+	}
+
+	if (compression == TMC_GZIP)
+	{
+		const uint8_t FHCRC = 0x02, FEXTRA = 0x04, FNAME = 0x08, FCOMMENT = 0x10;
+
+		if (size < 18 || src[0] != 0x1F || src[1] != 0x8B || src[2] != 8)
+			return false;
+
+		const uint8_t flags = src[3];
+		s.pos = 10;
+
+		if (flags & FEXTRA)
+		{
+			if (s.size - s.pos < 2)
+				return false;
+
+			s.pos += 2 + (src[s.pos] | (src[s.pos + 1] << 8));
+		}
+
+		for (uint8_t flag : { FNAME, FCOMMENT })
+		{
+			if (!(flags & flag))
+				continue;
+
+			while (s.pos < s.size && src[s.pos] != 0)
+				s.pos++;
+
+			s.pos++;
+		}
+
+		if (flags & FHCRC)
+			s.pos += 2;
+
+		if (s.pos > s.size || !inflateRaw(s) || s.size - s.pos < 8)
+			return false;
+
+		// CRC32 & the size modulo 2^32, both little endian
+		const uint32_t check = src[s.pos] | (src[s.pos + 1] << 8) | (src[s.pos + 2] << 16) | (static_cast<uint32_t>(src[s.pos + 3]) << 24);
+		const uint32_t isize = src[s.pos + 4] | (src[s.pos + 5] << 8) | (src[s.pos + 6] << 16) | (static_cast<uint32_t>(src[s.pos + 7]) << 24);
+		return isize == static_cast<uint32_t>(data.size() - start) && check == crc32(data.data() + start, data.size() - start);
+	}
+
+	return false;
+}
+
+// ---------------------------------------------------------------------------
+// Layer data
+// ---------------------------------------------------------------------------
+static TmxCompression strToCompression(const std::string & str)
+{
+	switch (cstr2int(str.c_str()))
+	{
+	case cstr2int(""):
+		return TMC_NONE;
+	case cstr2int("zlib"):
+		return TMC_ZLIB;
+	case cstr2int("gzip"):
+		return TMC_GZIP;
+	default:
+		return TMC_UNKNOWN;
+	}
+}
+
+bool decodeTmxGids(
+	const std::string & encoding,
+	const std::string & compression,
+	const char * str,
+	size_t length,
+	size_t n_gids,
+	std::vector<uint32_t> & gids
+)
+{
+	const size_t start = gids.size();
+
+	if (encoding == "csv")
+	{
+		if (!decodeCsvGids(str, length, gids))
+		{
+			LOG_ERROR("TmxDecode: Malformed CSV layer data!");
+			return false;
+		}
+	}
+	else if (encoding == "base64")
+	{
+		const TmxCompression tmc = strToCompression(compression);
+		std::vector<uint8_t> bytes, inflated;
+
+		if (tmc == TMC_UNKNOWN)
+		{
+			LOG_ERROR("TmxDecode: Unsupported layer compression: %s!", compression.c_str());
+			return false;
+		}
+
+		if (!decodeBase64(str, length, bytes))
+		{
+			LOG_ERROR("TmxDecode: Malformed base64 layer data!");
+			return false;
+		}
+
+		if (tmc != TMC_NONE)
+		{
+			inflated.reserve(n_gids * 4);
+
+			if (!inflateData(bytes.data(), bytes.size(), tmc, inflated))
+			{
+				LOG_ERROR("TmxDecode: Corrupt %s compressed layer data!", compression.c_str());
+				return false;
+			}
+
+			bytes.swap(inflated);
+		}
+
+		// Little endian gids
+		gids.reserve(start + bytes.size() / 4);
+		for (size_t i = 0; i + 3 < bytes.size(); i += 4)
+		{
+			const uint32_t gid = bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16) | (static_cast<uint32_t>(bytes[i + 3]) << 24);
+			gids.push_back(gid & TMX_GID_MASK);
+		}
+	}
+	else
+	{
+		LOG_ERROR("TmxDecode: Unsupported layer encoding: %s!", encoding.c_str());
+		return false;
+	}
+
+	if (gids.size() - start != n_gids)
+	{
+		LOG_ERROR("TmxDecode: Layer data holds %u gids instead of %u!", static_cast<uint32_t>(gids.size() - start), static_cast<uint32_t>(n_gids));
+		return false;
+	}
+
+	return true;
+}
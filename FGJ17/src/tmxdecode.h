@@ -0,0 +1,36 @@
+#ifndef TMXDECODE_H
+#define TMXDECODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tiled stores tile flips in the top three gid bits
+const uint32_t TMX_GID_MASK = 0x1FFFFFFF;
+
+enum TmxCompression : uint8_t
+{
+	TMC_NONE = 0,
+	TMC_ZLIB = 1,
+	TMC_GZIP = 2,
+	TMC_UNKNOWN = 0xFF
+};
+
+// Decoders for the encoded forms of a .tmx layer's <data>. All of them append
+// to their output & return false on malformed input. Input is not expected
+// to be null terminated.
+bool decodeCsvGids(const char * str, size_t length, std::vector<uint32_t> & gids);
+bool decodeBase64(const char * str, size_t length, std::vector<uint8_t> & data);
+bool inflateData(const uint8_t * src, size_t size, TmxCompression compression, std::vector<uint8_t> & data);
+
+// Decodes <data encoding="..." compression="..."> text into exactly n_gids gids
+bool decodeTmxGids(
+	const std::string & encoding,
+	const std::string & compression,
+	const char * str,
+	size_t length,
+	size_t n_gids,
+	std::vector<uint32_t> & gids
+);
+
+#endif // TMXDECODE_H
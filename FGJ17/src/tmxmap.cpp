@@ -1,14 +1,18 @@
 #include "tmxmap.h"
 #include <cstring>
-#include "3rdparty/pugixml.hpp"
-#include "3rdparty/pugiconfig.hpp"
+#include <deque>
 #include "game.h"
 #include "resmanager.h"
 #include "display.h"
+#include "cookedlevel.h"
+#include "mappedfile.h"
+#include "tmxdecode.h"
+#include "xmlreader.h"
 #include "macros.h"
 
 TmxMap::TmxMap(Game * const game, const std::string & filePath) :
 	m_filePath(filePath),
+	m_levelJson(),
 	m_mapData
 {
 	"NULL",								// version
@@ -24,203 +28,363 @@ TmxMap::TmxMap(Game * const game, const std::string & filePath) :
 	std::vector<TmxObjectgroupData>()	// objectgroups
 }
 {
-	// Load & parse the XML document
-	pugi::xml_document xml_doc;
-	pugi::xml_parse_result xml_res = xml_doc.load_file(m_filePath.c_str());
+	// Cooked levels are loaded as is, everything else is parsed as .tmx
+	const bool loaded = (CookedLevel::isCookedPath(m_filePath)) ? CookedLevel::read(m_filePath, m_mapData, m_levelJson) : loadTmx();
 
-	// Do not continue on error loading/parsing the file
-	if (xml_res.status != pugi::xml_parse_status::status_ok)
+	if (!loaded)
 	{
 		ERR("TmxMap: Error loading/parsing file (" << m_filePath << ")!");
 		return;
 	}
 
-	// .tmx <map> info start
-	auto & child_map = xml_doc.child("map");
-
-	m_mapData.version = child_map.attribute("version").value();
-	m_mapData.orientation = child_map.attribute("orientation").value();
-	m_mapData.renderorder = child_map.attribute("renderorder").value();
-	uint32_t map_width = m_mapData.width = std::stoi(child_map.attribute("width").value());
-	uint32_t map_height = m_mapData.height = std::stoi(child_map.attribute("height").value());
-	uint32_t tile_width = m_mapData.tilewidth = std::stoi(child_map.attribute("tilewidth").value());
-	uint32_t tile_height = m_mapData.tileheight = std::stoi(child_map.attribute("tileheight").value());
-
-	// .tmx <tileset> info start
-	auto & child_tileset = child_map.child("tileset");
-
-	m_mapData.tileset.firstgid = std::stoi(child_tileset.attribute("firstgid").value());
-	m_mapData.tileset.name = child_tileset.attribute("name").value();
-	m_mapData.tileset.source = child_tileset.child("image").attribute("source").value();
-	m_mapData.tileset.width = std::stoi(child_tileset.child("image").attribute("width").value());
-	m_mapData.tileset.height = std::stoi(child_tileset.child("image").attribute("height").value());
-	m_mapData.tileset.tilewidth = std::stoi(child_tileset.attribute("tilewidth").value());
-	m_mapData.tileset.tileheight = std::stoi(child_tileset.attribute("tileheight").value());
-
-	// .tmx <tileset> tiles
-	for (auto & tile = child_tileset.child("tile"); tile; tile = tile.next_sibling("tile"))
-	{
-		// Get tile properties
-		uint32_t tile_id = std::stoi(tile.attribute("id").value());
+	if (game != nullptr)
+		buildTiles(game);
+
+	LOG("TmxMap: File (" << m_filePath << ") loaded. Layers: " << m_mapData.layer.size());
+}
 
-		auto & child_tile_prop = tile.child("properties");
-		for (auto & prop = child_tile_prop.first_child(); prop; prop = prop.next_sibling())
+void TmxMap::render(Display * const display)
+{
+	for (auto & l : m_mapData.layer)
+	{
+		l.visitTiles([&](const Tile & t)
 		{
-			TmxTilePropertyData tile_property = std::make_pair(prop.attribute("name").value(), prop.attribute("value").value());
-			m_mapData.tileset.tileproperties[tile_id].push_back(tile_property);
-		}
+			t.render(display);
+		});
 	}
+}
 
-	// .tmx <layer> info start
-	for (auto & layer = child_map.child("layer"); layer; layer = layer.next_sibling("layer"))
-	{
-		// Initialize new tile layer
-		m_mapData.layer.push_back(TmxLayerData());
+TmxMapData &TmxMap::getMapData()
+{
+	return m_mapData;
+}
+
+// Level JSON of cooked levels, empty for .tmx maps
+const std::string & TmxMap::getLevelJson() const
+{
+	return m_levelJson;
+}
+
+bool TmxMap::loadTmx()
+{
+	// Stream the mapped file straight into the map data, no document is
+	// built, so memory use stays close to the size of the map data itself
+	MappedFile xml_file(m_filePath);
+	if (!xml_file.isOpen())
+		return false;
 
-		// Get layer basic properties
-		std::string layer_name = m_mapData.layer.back().name = layer.attribute("name").value();
-		uint32_t layer_width = m_mapData.layer.back().width = std::stoi(layer.attribute("width").value());
-		uint32_t layer_height = m_mapData.layer.back().height = std::stoi(layer.attribute("height").value());
+	XmlReader xml(reinterpret_cast<const char *>(xml_file.getData()), xml_file.getSize());
 
-		// Get layer properties
-		auto & child_layer_prop = layer.child("properties");
-		for (auto & prop = child_layer_prop.first_child(); prop; prop = prop.next_sibling())
+	// Raw properties & the strings they point to, resolved at the end
+	std::deque<std::string> property_strings;
+	std::map<uint32_t, TmxTilePropertiesData> tileset_properties;
+	std::vector<TmxTilePropertiesData> layer_properties;
+
+	// Reads the <property> children of a <properties> element
+	auto read_properties = [&](TmxTilePropertiesData & properties)
+	{
+		const uint32_t properties_depth = xml.getDepth();
+		while (xml.nextChild(properties_depth))
 		{
-			TmxTilePropertyData layer_property = std::make_pair(prop.attribute("name").value(), prop.attribute("value").value());
-			m_mapData.layer.back().layerproperties.push_back(layer_property);
+			if (!xml.isName("property"))
+				continue;
+
+			property_strings.push_back(xml.getAttribute("name"));
+			const char * name = property_strings.back().c_str();
+			property_strings.push_back(xml.getAttribute("value"));
+			properties.push_back(TmxTilePropertyData(name, property_strings.back().c_str()));
 		}
+	};
+
+	// .tmx <map> info start
+	if (!xml.nextChild(0) || !xml.isName("map"))
+		return false;
+
+	m_mapData.version = xml.getAttribute("version");
+	m_mapData.orientation = xml.getAttribute("orientation");
+	m_mapData.renderorder = xml.getAttribute("renderorder");
+	m_mapData.width = xml.getAttributeUInt("width");
+	uint32_t map_height = m_mapData.height = xml.getAttributeUInt("height");
+	m_mapData.tilewidth = xml.getAttributeUInt("tilewidth");
+	uint32_t tile_height = m_mapData.tileheight = xml.getAttributeUInt("tileheight");
 
-		// Get layer properties
-		auto layer_properties = m_mapData.layer.back().layerproperties;
+	const uint32_t map_depth = xml.getDepth();
+	bool tileset_loaded = false;
 
-		// Parse all layer tiles
-		uint32_t tile_index = 0;
-		auto & child_layer_data = layer.child("data");
-		for (auto & tile = child_layer_data.first_child(); tile; tile = tile.next_sibling())
+	while (xml.nextChild(map_depth))
+	{
+		// .tmx <tileset> info start, only the first tileset is used
+		if (xml.isName("tileset") && !tileset_loaded)
 		{
-			// Get tile gid
-			uint32_t tile_gid = std::stoi(tile.attribute("gid").value());
+			tileset_loaded = true;
+			m_mapData.tileset.firstgid = xml.getAttributeUInt("firstgid");
+			m_mapData.tileset.name = xml.getAttribute("name");
+			m_mapData.tileset.tilewidth = xml.getAttributeUInt("tilewidth");
+			m_mapData.tileset.tileheight = xml.getAttributeUInt("tileheight");
+
+			const uint32_t tileset_depth = xml.getDepth();
+			bool image_loaded = false;
 
-			if (tile_gid != 0)
+			while (xml.nextChild(tileset_depth))
 			{
-				// Decrement tile gid by one
-				tile_gid--;
-
-				// Calculate tile coordinates and indices
-				int32_t tile_x = m_mapData.tileset.tilewidth * (tile_index % layer_width);
-				int32_t tile_y = (m_mapData.tileset.tileheight * (layer_height - static_cast<int32_t>(std::ceil(tile_index / layer_width)))) - tile_height;
-				uint32_t tileset_x = m_mapData.tileset.tilewidth * (tile_gid % (m_mapData.tileset.width / m_mapData.tileset.tilewidth));
-				uint32_t tileset_y = m_mapData.tileset.tileheight * static_cast<uint32_t>(std::ceil(tile_gid / (m_mapData.tileset.width / m_mapData.tileset.tilewidth)));
-
-				// Fuse individual tile properties and the tile layer properties together
-				auto tile_properties = m_mapData.tileset.tileproperties[tile_gid];
-				tile_properties.insert(tile_properties.end(), layer_properties.begin(), layer_properties.end());
-
-				// Insert the new tile into our layer's data
-				m_mapData.layer.back().tiles.push_back(Tile(
-					game,
-					Sprite(
-						game->getResMan()->loadTexture(m_mapData.tileset.source),
-						tileset_x,
-						tileset_y,
-						m_mapData.tileset.tilewidth,
-						m_mapData.tileset.tileheight
-					),
-					vec2(static_cast<float>(tile_x), static_cast<float>(tile_y)),
-					Tile::strToLayer(layer_name),
-					Tile::strToProperties(tile_properties)
-				));
-			}
+				if (xml.isName("image") && !image_loaded)
+				{
+					image_loaded = true;
+					m_mapData.tileset.source = xml.getAttribute("source");
+					m_mapData.tileset.width = xml.getAttributeUInt("width");
+					m_mapData.tileset.height = xml.getAttributeUInt("height");
+				}
+				else if (xml.isName("tile"))
+				{
+					// .tmx <tileset> tiles
+					uint32_t tile_id = xml.getAttributeUInt("id");
 
-			// Increment tile index by one
-			tile_index++;
+					const uint32_t tile_depth = xml.getDepth();
+					while (xml.nextChild(tile_depth))
+					{
+						if (xml.isName("properties"))
+							read_properties(tileset_properties[tile_id]);
+					}
+				}
+			}
 		}
-	}
+		// .tmx <layer> info start
+		else if (xml.isName("layer"))
+		{
+			// Initialize new tile layer
+			m_mapData.layer.push_back(TmxLayerData());
+			layer_properties.push_back(TmxTilePropertiesData());
 
-	// .tmx <imagelayer> info
-	for (auto & ilayer = child_map.child("imagelayer"); ilayer; ilayer = ilayer.next_sibling("imagelayer"))
-	{
-		// Initialize new image layer
-		m_mapData.imglayer.push_back(TmxImgLayerData());
+			// Get layer basic properties
+			m_mapData.layer.back().name = xml.getAttribute("name");
+			uint32_t layer_width = m_mapData.layer.back().width = xml.getAttributeUInt("width");
+			uint32_t layer_height = m_mapData.layer.back().height = xml.getAttributeUInt("height");
 
-		// Get layer basic properties
-		m_mapData.imglayer.back().name = ilayer.attribute("name").value();
+			const uint32_t layer_depth = xml.getDepth();
+			while (xml.nextChild(layer_depth))
+			{
+				// Get layer properties
+				if (xml.isName("properties"))
+				{
+					read_properties(layer_properties.back());
+					continue;
+				}
 
-		// Parse all layer images
-		uint32_t ilayer_index = 0;
-		for (auto & image = ilayer.child("image"); image; image = image.next_sibling("image"))
-		{
-			// Get image properties
-			std::string ilayer_src = m_mapData.imglayer.back().source = image.attribute("source").value();
+				if (!xml.isName("data"))
+					continue;
 
-			// Increment image index by one
-			ilayer_index++;
-		}
-	}
+				// Parse all layer tile gids, 0 being an empty tile
+				std::vector<uint32_t> & gids = m_mapData.layer.back().gids;
+				const size_t n_gids = static_cast<size_t>(layer_width) * layer_height;
+				gids.reserve(n_gids);
 
-	// .tmx <objectgroup> info
-	for (auto & ogroup = child_map.child("objectgroup"); ogroup; ogroup = ogroup.next_sibling("objectgroup"))
-	{
-		// Initialize new object group
-		m_mapData.objectgroup.push_back(TmxObjectgroupData());
+				const uint32_t data_depth = xml.getDepth();
+				if (xml.hasAttribute("encoding"))
+				{
+					// CSV or base64, optionally zlib/gzip compressed
+					const std::string data_encoding = xml.getAttribute("encoding");
+					const std::string data_compression = xml.getAttribute("compression");
+					const bool has_text = xml.nextText(data_depth);
+
+					if (!decodeTmxGids(data_encoding, data_compression, (has_text) ? xml.getText() : "", (has_text) ? xml.getTextLength() : 0, n_gids, gids))
+						return false;
+				}
+				else
+				{
+					// One <tile gid="..."/> per tile, held to the layer size like
+					// the encoded data
+					const size_t start = gids.size();
+					while (xml.nextChild(data_depth))
+					{
+						if (gids.size() - start == n_gids)
+						{
+							LOG_ERROR("TmxMap: Layer data holds more than %u gids!", static_cast<uint32_t>(n_gids));
+							return false;
+						}
 
-		// Get layer basic properties
-		m_mapData.objectgroup.back().name = ogroup.attribute("name").value();
+						gids.push_back(xml.getAttributeUInt("gid") & TMX_GID_MASK);
+					}
 
-		// Parse all layer objects
-		uint32_t object_index = 0;
-		for (auto & object = ogroup.child("object"); object; object = object.next_sibling("object"))
+					if (xml.hasError())
+						break;
+
+					if (gids.size() - start != n_gids)
+					{
+						LOG_ERROR("TmxMap: Layer data holds %u gids instead of %u!", static_cast<uint32_t>(gids.size() - start), static_cast<uint32_t>(n_gids));
+						return false;
+					}
+				}
+			}
+		}
+		// .tmx <imagelayer> info
+		else if (xml.isName("imagelayer"))
 		{
-			// Calculate object properties and so on
-			uint32_t object_id = std::stoi(object.attribute("id").value());
-			std::string object_name = object.attribute("name").value();
-			std::string object_type = object.attribute("type").value();
-			int32_t object_x = std::stoi(object.attribute("x").value());
-			int32_t object_y = (map_height * tile_height) - std::stoi(object.attribute("y").value());
-			int32_t object_width = std::stoi(object.attribute("width").value());
-			int32_t object_height = std::stoi(object.attribute("height").value());
-
-			// Get object properties
-			TmxObjectPropertiesData object_properties;
-			auto & child_object_prop = object.child("properties");
-			for (auto & prop = child_object_prop.first_child(); prop; prop = prop.next_sibling())
+			// Initialize new image layer
+			m_mapData.imglayer.push_back(TmxImgLayerData());
+
+			// Get layer basic properties
+			m_mapData.imglayer.back().name = xml.getAttribute("name");
+
+			// Parse all layer images
+			const uint32_t ilayer_depth = xml.getDepth();
+			while (xml.nextChild(ilayer_depth))
 			{
-				TmxObjectPropertyData object_property = std::make_pair(prop.attribute("name").value(), prop.attribute("value").value());
-				object_properties.push_back(object_property);
+				// Get image properties
+				if (xml.isName("image"))
+					m_mapData.imglayer.back().source = xml.getAttribute("source");
 			}
+		}
+		// .tmx <objectgroup> info
+		else if (xml.isName("objectgroup"))
+		{
+			// Initialize new object group
+			m_mapData.objectgroup.push_back(TmxObjectgroupData());
 
-			// Insert the object into our layer's data
-			m_mapData.objectgroup.back().objects.push_back(TmxObject{
-				object_id,
-				object_name,
-				object_type,
-				object_x,
-				object_y,
-				object_width,
-				object_height,
-				object_properties
-			});
+			// Get layer basic properties
+			m_mapData.objectgroup.back().name = xml.getAttribute("name");
 
-			// Increment object index by one
-			object_index++;
+			// Parse all layer objects
+			const uint32_t ogroup_depth = xml.getDepth();
+			while (xml.nextChild(ogroup_depth))
+			{
+				if (!xml.isName("object"))
+					continue;
+
+				// Calculate object properties and so on, attributes are only
+				// valid until the reader moves on to the object's children
+				uint32_t object_id = xml.getAttributeUInt("id");
+				std::string object_name = xml.getAttribute("name");
+				std::string object_type = xml.getAttribute("type");
+				int32_t object_x = xml.getAttributeInt("x");
+				int32_t object_y = (map_height * tile_height) - xml.getAttributeInt("y");
+				int32_t object_width = xml.getAttributeInt("width");
+				int32_t object_height = xml.getAttributeInt("height");
+
+				// Get object properties
+				TmxObjectPropertiesData object_properties;
+				const uint32_t object_depth = xml.getDepth();
+				while (xml.nextChild(object_depth))
+				{
+					if (xml.isName("properties"))
+						read_properties(object_properties);
+				}
+
+				// Insert the object into our layer's data
+				m_mapData.objectgroup.back().objects.push_back(TmxObject{
+					object_id,
+					object_name,
+					object_type,
+					object_x,
+					object_y,
+					object_width,
+					object_height,
+					strToProperties(object_properties)
+				});
+			}
 		}
 	}
 
-	LOG("TmxMap: File (" << m_filePath << ") loaded. Layers: " << m_mapData.layer.size());
+	if (xml.hasError())
+	{
+		ERR("TmxMap: Malformed XML in file (" << m_filePath << ") at line " << xml.getLine() << "!");
+		return false;
+	}
+
+	resolveProperties(tileset_properties, layer_properties);
+
+	return true;
 }
 
-void TmxMap::render(Display * const display)
+// Fuses the tileset properties of every gid used on a layer with the layer's
+// own properties, once per gid instead of once per tile
+void TmxMap::resolveProperties(
+	const std::map<uint32_t, TmxTilePropertiesData> & tilesetProperties,
+	const std::vector<TmxTilePropertiesData> & layerProperties
+)
 {
-	for (auto & l : m_mapData.layer)
+	for (size_t i = 0; i < m_mapData.layer.size(); i++)
 	{
-		for (auto & t : l.tiles)
+		TmxLayerData & l = m_mapData.layer[i];
+
+		for (uint32_t gid : l.gids)
 		{
-			t.render(display);
+			if (gid == 0 || l.tileProperties.count(gid) != 0)
+				continue;
+
+			// Tileset tile ids are gids decremented by one
+			TmxTilePropertiesData tile_properties;
+			auto it = tilesetProperties.find(gid - 1);
+			if (it != tilesetProperties.end())
+				tile_properties = it->second;
+
+			tile_properties.insert(tile_properties.end(), layerProperties[i].begin(), layerProperties[i].end());
+			l.tileProperties[gid] = strToProperties(tile_properties);
 		}
 	}
 }
 
-TmxMapData &TmxMap::getMapData()
+// Builds one prototype per gid used on a layer, then the layer's tiles
+// pointing to them. Prototypes are complete before the first tile is placed,
+// so the pointers stay valid.
+void TmxMap::buildTiles(Game * const game)
 {
-	return m_mapData;
+	const TextureRegion * const tileset = game->getResMan()->loadTexture(m_mapData.tileset.source);
+	const uint32_t tileset_columns = (m_mapData.tileset.tilewidth > 0) ? m_mapData.tileset.width / m_mapData.tileset.tilewidth : 0;
+	const uint32_t tileset_rows = (m_mapData.tileset.tileheight > 0) ? m_mapData.tileset.height / m_mapData.tileset.tileheight : 0;
+	const uint32_t tileset_tiles = tileset_columns * tileset_rows;
+
+	for (TmxLayerData & l : m_mapData.layer)
+	{
+		size_t n_invalid = 0;
+
+		l.layer = Tile::strToLayer(l.name);
+		l.tileWidth = m_mapData.tilewidth;
+		l.tileHeight = m_mapData.tileheight;
+		l.prototypes.clear();
+		l.prototypeIndex.clear();
+
+		// Tiles are looked up by slot, every slot has to be there
+		l.gids.resize(static_cast<size_t>(l.width) * l.height, 0);
+
+		for (uint32_t & tile_gid : l.gids)
+		{
+			// Drop the flip flags, gids outside of the tileset are left empty
+			tile_gid &= TMX_GID_MASK;
+
+			if (tile_gid > tileset_tiles)
+			{
+				tile_gid = 0;
+				n_invalid++;
+			}
+
+			if (tile_gid == 0)
+				continue;
+
+			if (tile_gid >= l.prototypeIndex.size())
+				l.prototypeIndex.resize(tile_gid + 1, -1);
+
+			if (l.prototypeIndex[tile_gid] >= 0)
+				continue;
+
+			// Tileset source rect of the gid
+			uint32_t tileset_x = m_mapData.tileset.tilewidth * ((tile_gid - 1) % tileset_columns);
+			uint32_t tileset_y = m_mapData.tileset.tileheight * ((tile_gid - 1) / tileset_columns);
+
+			l.prototypeIndex[tile_gid] = static_cast<int32_t>(l.prototypes.size());
+			l.prototypes.push_back(TilePrototype{
+				Sprite(
+					tileset,
+					tileset_x,
+					tileset_y,
+					m_mapData.tileset.tilewidth,
+					m_mapData.tileset.tileheight
+				),
+				l.layer,
+				l.tileProperties[tile_gid]
+			});
+		}
+
+		if (n_invalid > 0)
+			LOG_ERROR("TmxMap: Layer %s holds %u gids outside of the %u tiles of tileset %s!", l.name.c_str(), static_cast<uint32_t>(n_invalid), tileset_tiles, m_mapData.tileset.name.c_str());
+	}
 }
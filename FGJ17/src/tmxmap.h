@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <utility>
+#include <algorithm>
 #include "tmxtile.h"
 #include "tmxobject.h"
 #include "tile.h"
@@ -21,7 +22,7 @@ struct TmxObject
 	int32_t y;
 	int32_t width;
 	int32_t height;
-	TmxObjectPropertiesData objectproperties;
+	Properties properties;
 };
 
 struct TmxObjectgroupData
@@ -41,8 +42,47 @@ struct TmxLayerData
 	std::string name;
 	uint32_t width;
 	uint32_t height;
-	TmxTilePropertiesData layerproperties;
-	std::vector<Tile> tiles;
+	std::vector<uint32_t> gids;
+	std::map<uint32_t, Properties> tileProperties;
+	std::vector<TilePrototype> prototypes;
+	std::vector<int32_t> prototypeIndex;
+	TileLayer layer;
+	uint32_t tileWidth;
+	uint32_t tileHeight;
+
+	// Calls visitor(const Tile &) for every tile within the inclusive tile
+	// range, row by row, y up. Tiles are not stored, a tile is its gid in the
+	// slot & is put together from the gid's prototype & the slot position.
+	template<typename F>
+	void visitTiles(int32_t tx0, int32_t ty0, int32_t tx1, int32_t ty1, F && visitor) const
+	{
+		// Without built prototypes there are no tiles
+		if (prototypes.empty())
+			return;
+
+		tx0 = std::max(tx0, 0);
+		ty0 = std::max(ty0, 0);
+		tx1 = std::min(tx1, static_cast<int32_t>(width) - 1);
+		ty1 = std::min(ty1, static_cast<int32_t>(height) - 1);
+
+		for (int32_t ty = ty0; ty <= ty1; ty++)
+		{
+			// Gids are stored top row first
+			const uint32_t * row = &gids[static_cast<size_t>(height - 1 - ty) * width];
+
+			for (int32_t tx = tx0; tx <= tx1; tx++)
+			{
+				if (row[tx] != 0)
+					visitor(Tile(&prototypes[prototypeIndex[row[tx]]], vec2(static_cast<float>(tx * tileWidth), static_cast<float>(ty * tileHeight))));
+			}
+		}
+	}
+
+	template<typename F>
+	void visitTiles(F && visitor) const
+	{
+		visitTiles(0, 0, static_cast<int32_t>(width) - 1, static_cast<int32_t>(height) - 1, visitor);
+	}
 };
 
 struct TmxTilesetData
@@ -54,7 +94,6 @@ struct TmxTilesetData
 	uint32_t height;
 	uint32_t tilewidth;
 	uint32_t tileheight;
-	std::map<int, TmxTilePropertiesData> tileproperties;
 };
 
 struct TmxMapData
@@ -72,14 +111,25 @@ struct TmxMapData
 	std::vector<TmxObjectgroupData> objectgroup;
 };
 
+// Loads .tmx maps & cooked .lvl levels into the same map data. Without a
+// game only the map data is loaded, no tiles are built.
 class TmxMap
 {
 public:
 	TmxMap(Game * const game, const std::string & filePath);
 	void render(Display * const display);
 	TmxMapData & getMapData();
+	const std::string & getLevelJson() const;
 private:
+	bool loadTmx();
+	void resolveProperties(
+		const std::map<uint32_t, TmxTilePropertiesData> & tilesetProperties,
+		const std::vector<TmxTilePropertiesData> & layerProperties
+	);
+	void buildTiles(Game * const game);
+
 	std::string m_filePath;
+	std::string m_levelJson;
 	TmxMapData m_mapData;
 };
 
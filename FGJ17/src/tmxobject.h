@@ -4,7 +4,7 @@
 #include <vector>
 #include <algorithm>
 
-typedef std::pair<std::string, std::string> TmxObjectPropertyData;
+typedef std::pair<const char *, const char *> TmxObjectPropertyData;
 typedef std::vector<TmxObjectPropertyData> TmxObjectPropertiesData;
 
 #endif // TMXOBJECT_H
\ No newline at end of file
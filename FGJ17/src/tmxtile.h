@@ -4,7 +4,7 @@
 #include <vector>
 #include <algorithm>
 
-typedef std::pair<std::string, std::string> TmxTilePropertyData;
+typedef std::pair<const char *, const char *> TmxTilePropertyData;
 typedef std::vector<TmxTilePropertyData> TmxTilePropertiesData;
 
 #endif // TMXTILE_H
\ No newline at end of file
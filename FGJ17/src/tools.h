@@ -3,6 +3,7 @@
 
 #include <string>
 #include <sstream>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
 #include <functional>
@@ -10,6 +11,7 @@
 
 // Because MSVC is retarded
 #ifdef _MSC_VER
+#include <intrin.h>
 #define strncasecmp _strnicmp
 #define strcasecmp _stricmp
 #endif
@@ -49,6 +51,28 @@ constexpr unsigned int cstr2int(const char * str, int h = 0)
 	return !str[h] ? 5381 : (cstr2int(str, h + 1) * 33) ^ str[h];
 }
 
+// ---------------------------------------------------------------------------
+// ctz64
+// Counts the trailing zero bits of a non-zero 64-bit integer.
+// ---------------------------------------------------------------------------
+inline uint32_t ctz64(uint64_t v)
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_ARM))
+	// No 64-bit bit scan on 32-bit targets, scan the low half, then the high half
+	unsigned long i;
+	if (_BitScanForward(&i, static_cast<unsigned long>(v)))
+		return static_cast<uint32_t>(i);
+	_BitScanForward(&i, static_cast<unsigned long>(v >> 32));
+	return static_cast<uint32_t>(i) + 32;
+#elif defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return static_cast<uint32_t>(i);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(v));
+#endif
+}
+
 // ---------------------------------------------------------------------------
 // filetofilepath
 // Converts a filepath ending to a file into a path to the folder of the file.
@@ -0,0 +1,464 @@
+#include "xmlreader.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+XmlReader::XmlReader(const char * data, size_t size) :
+	m_begin(data),
+	m_pos(data),
+	m_end(data + size),
+	m_event(XE_END_DOCUMENT),
+	m_name{ nullptr, 0 },
+	m_text{ nullptr, 0 },
+	m_attributes(),
+	m_open(),
+	m_emptyElement(false),
+	m_rootSeen(false)
+{
+	// UTF-8 byte order mark
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+		m_pos += 3;
+}
+
+XmlEvent XmlReader::next()
+{
+	if (m_event == XE_ERROR)
+		return XE_ERROR;
+
+	// <name/> is reported as a start & an end element
+	if (m_emptyElement)
+	{
+		m_emptyElement = false;
+		m_open.pop_back();
+		return m_event = XE_END_ELEMENT;
+	}
+
+	while (m_pos < m_end)
+	{
+		if (*m_pos != '<')
+		{
+			const char * lt = static_cast<const char *>(memchr(m_pos, '<', m_end - m_pos));
+			const char * end = (lt != nullptr) ? lt : m_end;
+			const char * c = m_pos;
+
+			while (c < end && isSpace(*c))
+				c++;
+
+			m_text = XmlSpan{ m_pos, static_cast<size_t>(end - m_pos) };
+			m_pos = end;
+
+			if (c == end)
+				continue;
+
+			// Only markup may surround the root element
+			if (m_open.empty())
+				return fail();
+
+			return m_event = XE_TEXT;
+		}
+
+		if (m_end - m_pos >= 2 && m_pos[1] == '?')
+		{
+			if (!skipPast("?>"))
+				return fail();
+		}
+		else if (m_end - m_pos >= 4 && memcmp(m_pos, "<!--", 4) == 0)
+		{
+			if (!skipPast("-->"))
+				return fail();
+		}
+		else if (m_end - m_pos >= 9 && memcmp(m_pos, "<![CDATA[", 9) == 0)
+		{
+			const char * start = m_pos + 9;
+
+			if (m_open.empty() || !skipPast("]]>"))
+				return fail();
+
+			m_text = XmlSpan{ start, static_cast<size_t>(m_pos - 3 - start) };
+			return m_event = XE_TEXT;
+		}
+		else if (m_end - m_pos >= 2 && m_pos[1] == '!')
+		{
+			// DOCTYPE, internal subsets are not supported
+			const char * gt = static_cast<const char *>(memchr(m_pos, '>', m_end - m_pos));
+
+			if (gt == nullptr || std::find(m_pos, gt, '[') != gt)
+				return fail();
+
+			m_pos = gt + 1;
+		}
+		else if (m_end - m_pos >= 2 && m_pos[1] == '/')
+		{
+			return readEndElement();
+		}
+		else
+		{
+			return readStartElement();
+		}
+	}
+
+	// Every element has to be closed by the end of the document
+	if (!m_open.empty() || !m_rootSeen)
+		return fail();
+
+	return m_event = XE_END_DOCUMENT;
+}
+
+// Advances to the next child element of the open element at depth, false
+// once that element ends. Deeper elements & text are skipped.
+bool XmlReader::nextChild(uint32_t depth)
+{
+	if (getDepth() < depth)
+		return false;
+
+	for (;;)
+	{
+		switch (next())
+		{
+		case XE_START_ELEMENT:
+			if (getDepth() == depth + 1)
+				return true;
+			break;
+		case XE_END_ELEMENT:
+			if (getDepth() < depth)
+				return false;
+			break;
+		case XE_TEXT:
+			break;
+		default:
+			return false;
+		}
+	}
+}
+
+// Advances to the next text directly within the open element at depth,
+// false once that element ends
+bool XmlReader::nextText(uint32_t depth)
+{
+	if (getDepth() < depth)
+		return false;
+
+	for (;;)
+	{
+		switch (next())
+		{
+		case XE_START_ELEMENT:
+			break;
+		case XE_END_ELEMENT:
+			if (getDepth() < depth)
+				return false;
+			break;
+		case XE_TEXT:
+			if (getDepth() == depth)
+				return true;
+			break;
+		default:
+			return false;
+		}
+	}
+}
+
+// Number of open elements, the depth of the element just started
+uint32_t XmlReader::getDepth() const
+{
+	return static_cast<uint32_t>(m_open.size());
+}
+
+bool XmlReader::hasError() const
+{
+	return m_event == XE_ERROR;
+}
+
+// Line of the current position, for error messages
+uint32_t XmlReader::getLine() const
+{
+	return 1 + static_cast<uint32_t>(std::count(m_begin, m_pos, '\n'));
+}
+
+// Name of the current start or end element
+bool XmlReader::isName(const char * name) const
+{
+	return strlen(name) == m_name.length && memcmp(name, m_name.str, m_name.length) == 0;
+}
+
+bool XmlReader::hasAttribute(const char * name) const
+{
+	return findAttribute(name) != nullptr;
+}
+
+// Unescaped attribute value, empty if missing
+std::string XmlReader::getAttribute(const char * name) const
+{
+	const XmlAttribute * attribute = findAttribute(name);
+	std::string value;
+
+	if (attribute == nullptr)
+		return value;
+
+	const char * c = attribute->value.str;
+	const char * end = c + attribute->value.length;
+	value.reserve(attribute->value.length);
+
+	while (c < end)
+	{
+		const char * amp = std::find(c, end, '&');
+		value.append(c, amp);
+		c = amp;
+
+		if (c == end)
+			break;
+
+		// A lone '&' is kept as written
+		const char * semicolon = std::find(c, end, ';');
+		if (semicolon == end)
+		{
+			value.append(c, end);
+			break;
+		}
+
+		const std::string entity(c + 1, semicolon);
+		c = semicolon + 1;
+
+		if (entity == "lt")
+			value += '<';
+		else if (entity == "gt")
+			value += '>';
+		else if (entity == "amp")
+			value += '&';
+		else if (entity == "quot")
+			value += '"';
+		else if (entity == "apos")
+			value += '\'';
+		else if (entity.size() > 1 && entity[0] == '#')
+		{
+			// Character reference, written out as UTF-8
+			const uint32_t cp = static_cast<uint32_t>((entity[1] == 'x') ? strtoul(entity.c_str() + 2, nullptr, 16) : strtoul(entity.c_str() + 1, nullptr, 10));
+
+			if (cp < 0x80)
+			{
+				value += static_cast<char>(cp);
+			}
+			else if (cp < 0x800)
+			{
+				value += static_cast<char>(0xC0 | (cp >> 6));
+				value += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+			else if (cp < 0x10000)
+			{
+				value += static_cast<char>(0xE0 | (cp >> 12));
+				value += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+				value += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+			else
+			{
+				value += static_cast<char>(0xF0 | ((cp >> 18) & 0x07));
+				value += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+				value += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+				value += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+		}
+		else
+		{
+			// Unknown entities are kept as written
+			value += '&';
+			value += entity;
+			value += ';';
+		}
+	}
+
+	return value;
+}
+
+// Leading digits of the attribute value, 0 if missing
+uint32_t XmlReader::getAttributeUInt(const char * name) const
+{
+	const XmlAttribute * attribute = findAttribute(name);
+	uint32_t value = 0;
+
+	if (attribute == nullptr)
+		return value;
+
+	const char * c = attribute->value.str;
+	const char * end = c + attribute->value.length;
+
+	while (c < end && isSpace(*c))
+		c++;
+
+	for (; c < end && *c >= '0' && *c <= '9'; c++)
+		value = value * 10 + static_cast<uint32_t>(*c - '0');
+
+	return value;
+}
+
+// Leading integer of the attribute value, fractions are dropped
+int32_t XmlReader::getAttributeInt(const char * name) const
+{
+	const XmlAttribute * attribute = findAttribute(name);
+	uint32_t value = 0;
+	bool negative = false;
+
+	if (attribute == nullptr)
+		return value;
+
+	const char * c = attribute->value.str;
+	const char * end = c + attribute->value.length;
+
+	while (c < end && isSpace(*c))
+		c++;
+
+	if (c < end && (*c == '-' || *c == '+'))
+		negative = (*c++ == '-');
+
+	for (; c < end && *c >= '0' && *c <= '9'; c++)
+		value = value * 10 + static_cast<uint32_t>(*c - '0');
+
+	return static_cast<int32_t>((negative) ? 0u - value : value);
+}
+
+// Raw text, entities are not expanded
+const char * XmlReader::getText() const
+{
+	return m_text.str;
+}
+
+size_t XmlReader::getTextLength() const
+{
+	return m_text.length;
+}
+
+XmlEvent XmlReader::readStartElement()
+{
+	// A second root element
+	if (m_open.empty() && m_rootSeen)
+		return fail();
+
+	m_pos++;
+	m_name = readName();
+	m_attributes.clear();
+
+	if (m_name.length == 0)
+		return fail();
+
+	for (;;)
+	{
+		skipSpace();
+
+		if (m_pos >= m_end)
+			return fail();
+
+		if (*m_pos == '>')
+		{
+			m_pos++;
+			break;
+		}
+
+		if (*m_pos == '/')
+		{
+			if (m_end - m_pos < 2 || m_pos[1] != '>')
+				return fail();
+
+			m_pos += 2;
+			m_emptyElement = true;
+			break;
+		}
+
+		// name = "value" or 'value'
+		const XmlSpan name = readName();
+		skipSpace();
+
+		if (name.length == 0 || m_pos >= m_end || *m_pos != '=')
+			return fail();
+
+		m_pos++;
+		skipSpace();
+
+		if (m_pos >= m_end || (*m_pos != '"' && *m_pos != '\''))
+			return fail();
+
+		const char * quote = static_cast<const char *>(memchr(m_pos + 1, *m_pos, m_end - m_pos - 1));
+		if (quote == nullptr)
+			return fail();
+
+		m_attributes.push_back(XmlAttribute{ name, XmlSpan{ m_pos + 1, static_cast<size_t>(quote - m_pos - 1) } });
+		m_pos = quote + 1;
+	}
+
+	m_rootSeen = true;
+	m_open.push_back(m_name);
+
+	return m_event = XE_START_ELEMENT;
+}
+
+XmlEvent XmlReader::readEndElement()
+{
+	m_pos += 2;
+	m_name = readName();
+	skipSpace();
+
+	if (m_pos >= m_end || *m_pos != '>')
+		return fail();
+
+	m_pos++;
+
+	// End tags have to match the innermost open element
+	if (m_open.empty() || m_open.back().length != m_name.length || memcmp(m_open.back().str, m_name.str, m_name.length) != 0)
+		return fail();
+
+	m_open.pop_back();
+	m_attributes.clear();
+
+	return m_event = XE_END_ELEMENT;
+}
+
+XmlReader::XmlSpan XmlReader::readName()
+{
+	const char * start = m_pos;
+
+	while (m_pos < m_end && !isSpace(*m_pos) && *m_pos != '/' && *m_pos != '>' && *m_pos != '=')
+		m_pos++;
+
+	return XmlSpan{ start, static_cast<size_t>(m_pos - start) };
+}
+
+// Moves past the next occurrence of token, false if there is none
+bool XmlReader::skipPast(const char * token)
+{
+	const size_t length = strlen(token);
+	const char * found = std::search(m_pos, m_end, token, token + length);
+
+	if (found == m_end)
+		return false;
+
+	m_pos = found + length;
+	return true;
+}
+
+void XmlReader::skipSpace()
+{
+	while (m_pos < m_end && isSpace(*m_pos))
+		m_pos++;
+}
+
+const XmlReader::XmlAttribute * XmlReader::findAttribute(const char * name) const
+{
+	const size_t length = strlen(name);
+
+	for (const XmlAttribute & a : m_attributes)
+	{
+		if (a.name.length == length && memcmp(a.name.str, name, length) == 0)
+			return &a;
+	}
+
+	return nullptr;
+}
+
+XmlEvent XmlReader::fail()
+{
+	m_emptyElement = false;
+	return m_event = XE_ERROR;
+}
@@ -0,0 +1,73 @@
+#ifndef XMLREADER_H
+#define XMLREADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum XmlEvent : uint8_t
+{
+	XE_START_ELEMENT = 0,
+	XE_END_ELEMENT = 1,
+	XE_TEXT = 2,
+	XE_END_DOCUMENT = 3,
+	XE_ERROR = 0xFF
+};
+
+// Pull parser over an XML document in memory. Nothing is copied or built,
+// names, attributes & text point into the document and are valid until the
+// next event, so memory use depends on nesting depth, not document size.
+// Covers what Tiled writes: elements, attributes, text, CDATA, comments,
+// processing instructions & a DOCTYPE without internal subset. Whitespace
+// only text is skipped, text is returned as is, attributes are unescaped.
+class XmlReader
+{
+public:
+	XmlReader(const char * data, size_t size);
+	XmlEvent next();
+	bool nextChild(uint32_t depth);
+	bool nextText(uint32_t depth);
+	uint32_t getDepth() const;
+	bool hasError() const;
+	uint32_t getLine() const;
+	bool isName(const char * name) const;
+	bool hasAttribute(const char * name) const;
+	std::string getAttribute(const char * name) const;
+	uint32_t getAttributeUInt(const char * name) const;
+	int32_t getAttributeInt(const char * name) const;
+	const char * getText() const;
+	size_t getTextLength() const;
+private:
+	struct XmlSpan
+	{
+		const char * str;
+		size_t length;
+	};
+
+	struct XmlAttribute
+	{
+		XmlSpan name;
+		XmlSpan value;
+	};
+
+	XmlEvent readStartElement();
+	XmlEvent readEndElement();
+	XmlSpan readName();
+	bool skipPast(const char * token);
+	void skipSpace();
+	const XmlAttribute * findAttribute(const char * name) const;
+	XmlEvent fail();
+
+	const char * m_begin;
+	const char * m_pos;
+	const char * m_end;
+	XmlEvent m_event;
+	XmlSpan m_name;
+	XmlSpan m_text;
+	std::vector<XmlAttribute> m_attributes;
+	std::vector<XmlSpan> m_open;
+	bool m_emptyElement;
+	bool m_rootSeen;
+};
+
+#endif // XMLREADER_H